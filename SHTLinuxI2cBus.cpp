@@ -0,0 +1,191 @@
+/*
+ *  Copyright (c) 2018, Sensirion AG
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *      * Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright
+ *        notice, this list of conditions and the following disclaimer in the
+ *        documentation and/or other materials provided with the distribution.
+ *      * Neither the name of the Sensirion AG nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "SHTLinuxI2cBus.h"
+
+
+//
+// class SHTLinuxI2cBus
+//
+
+SHTLinuxI2cBus::~SHTLinuxI2cBus()
+{
+  end();
+}
+
+bool SHTLinuxI2cBus::begin()
+{
+  end();
+  mFd = open(mDevice, O_RDWR | O_CLOEXEC);
+  if (mFd < 0) {
+    return false;
+  }
+  if (ioctl(mFd, I2C_FUNCS, &mFunctionality) < 0) {
+    mFunctionality = 0;
+  }
+  return true;
+}
+
+void SHTLinuxI2cBus::end()
+{
+  if (mFd >= 0) {
+    close(mFd);
+    mFd = -1;
+    mFunctionality = 0;
+  }
+}
+
+bool SHTLinuxI2cBus::write(uint8_t i2cAddress, const uint8_t *data,
+                           uint8_t length)
+{
+  struct i2c_msg message;
+  message.addr = i2cAddress;
+  message.flags = 0;
+  message.len = length;
+  message.buf = const_cast<uint8_t *>(data);
+  return transfer(&message, 1);
+}
+
+bool SHTLinuxI2cBus::read(uint8_t i2cAddress, uint8_t *data, uint8_t length)
+{
+  struct i2c_msg message;
+  message.addr = i2cAddress;
+  message.flags = I2C_M_RD;
+  message.len = length;
+  message.buf = data;
+  return transfer(&message, 1);
+}
+
+bool SHTLinuxI2cBus::writeRead(uint8_t i2cAddress, const uint8_t *command,
+                               uint8_t commandLength, uint8_t *data,
+                               uint8_t dataLength)
+{
+  struct i2c_msg messages[2];
+  messages[0].addr = i2cAddress;
+  messages[0].flags = 0;
+  messages[0].len = commandLength;
+  messages[0].buf = const_cast<uint8_t *>(command);
+  messages[1].addr = i2cAddress;
+  messages[1].flags = I2C_M_RD;
+  messages[1].len = dataLength;
+  messages[1].buf = data;
+  return transfer(messages, 2);
+}
+
+bool SHTLinuxI2cBus::probe(uint8_t i2cAddress)
+{
+  if ((mFunctionality & I2C_FUNC_SMBUS_QUICK) &&
+      ioctl(mFd, I2C_SLAVE, (unsigned long)i2cAddress) >= 0) {
+    struct i2c_smbus_ioctl_data args;
+    args.read_write = I2C_SMBUS_WRITE;
+    args.command = 0;
+    args.size = I2C_SMBUS_QUICK;
+    args.data = NULL;
+    return ioctl(mFd, I2C_SMBUS, &args) >= 0;
+  }
+
+  // adapters with the I2C_AQ_NO_ZERO_LEN quirk reject zero length messages
+  if (SHTI2cBus::probe(i2cAddress)) {
+    return true;
+  }
+  uint8_t data;
+  return read(i2cAddress, &data, 1);
+}
+
+uint8_t SHTLinuxI2cBus::readBatch(ReadTransfer *transfers, uint8_t count)
+{
+  // keep going past a device that does not respond, see checkWords()
+  bool ignoreNak = (mFunctionality & I2C_FUNC_PROTOCOL_MANGLING) != 0;
+  uint8_t successful = 0;
+  // wider than `count', so the index cannot wrap around
+  for (uint16_t first = 0; first < count; first += MAX_BATCH_READS) {
+    uint8_t chunk = count - first;
+    if (chunk > MAX_BATCH_READS) {
+      chunk = MAX_BATCH_READS;
+    }
+
+    struct i2c_msg messages[MAX_BATCH_READS];
+    for (uint8_t i = 0; i < chunk; ++i) {
+      messages[i].addr = transfers[first + i].i2cAddress;
+      messages[i].flags = ignoreNak ? I2C_M_RD | I2C_M_IGNORE_NAK : I2C_M_RD;
+      messages[i].len = transfers[first + i].length;
+      messages[i].buf = transfers[first + i].data;
+    }
+
+    if (transfer(messages, chunk)) {
+      for (uint8_t i = 0; i < chunk; ++i) {
+        ReadTransfer &result = transfers[first + i];
+        result.success = !ignoreNak || checkWords(result);
+        if (result.success) {
+          ++successful;
+        }
+      }
+    } else {
+      // the kernel does not report which message failed; the results read
+      // before it are gone, only the devices after it can still answer
+      successful += SHTI2cBus::readBatch(&transfers[first], chunk);
+    }
+  }
+  return successful;
+}
+
+bool SHTLinuxI2cBus::checkWords(const ReadTransfer &transfer)
+{
+  // a device not acknowledging its address leaves the bus high, and the
+  // CRC of 0xffff is not 0xff
+  if (transfer.length < 3) {
+    return false;
+  }
+  for (uint8_t i = 0; i + 3 <= transfer.length; i += 3) {
+    if (SHTI2cSensor::crc8(&transfer.data[i], 2) != transfer.data[i + 2]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SHTLinuxI2cBus::transfer(struct i2c_msg *messages, uint32_t count)
+{
+  if (mFd < 0) {
+    return false;
+  }
+  struct i2c_rdwr_ioctl_data transaction;
+  transaction.msgs = messages;
+  transaction.nmsgs = count;
+  // returns the number of messages transferred
+  return ioctl(mFd, I2C_RDWR, &transaction) == (int)count;
+}
+
+#endif /* __linux__ && !ARDUINO */
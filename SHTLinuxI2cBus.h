@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) 2018, Sensirion AG
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *      * Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright
+ *        notice, this list of conditions and the following disclaimer in the
+ *        documentation and/or other materials provided with the distribution.
+ *      * Neither the name of the Sensirion AG nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SHTLINUXI2CBUS_H
+#define SHTLINUXI2CBUS_H
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <inttypes.h>
+
+#include "SHTSensor.h"
+
+struct i2c_msg;
+
+/**
+ * SHTI2cBus on a Linux i2c-dev character device, e.g. /dev/i2c-1
+ *
+ * Each transfer is issued as a single I2C_RDWR ioctl, so a command and its
+ * reply (see writeRead()) take one system call and are sent as one combined
+ * transaction with a repeated start. The reads of several sensors (see
+ * readBatch()) are combined the same way. The kernel module i2c-dev must be
+ * loaded.
+ *
+ * Example usage:
+ * SHTLinuxI2cBus bus("/dev/i2c-1");
+ * SHTSensor sht(bus, SHTSensor::SHT3X);
+ * if (bus.begin() && sht.init()) { ... }
+ */
+class SHTLinuxI2cBus : public SHTI2cBus
+{
+public:
+  /**
+   * Instantiate a bus on the i2c-dev `device' path, e.g. "/dev/i2c-1"
+   * The string is not copied and must outlive the bus.
+   */
+  SHTLinuxI2cBus(const char *device)
+      : mDevice(device), mFd(-1), mFunctionality(0)
+  {
+  }
+
+  virtual ~SHTLinuxI2cBus();
+
+  /**
+   * Open the device
+   * Returns true if the device was opened
+   */
+  bool begin();
+
+  /** Close the device */
+  void end();
+
+  virtual bool write(uint8_t i2cAddress, const uint8_t *data, uint8_t length);
+  virtual bool read(uint8_t i2cAddress, uint8_t *data, uint8_t length);
+  virtual bool writeRead(uint8_t i2cAddress, const uint8_t *command,
+                         uint8_t commandLength, uint8_t *data,
+                         uint8_t dataLength);
+
+  /**
+   * Probe with an SMBus quick write if the adapter supports it. Otherwise a
+   * zero length write is tried, which some adapters reject, and then a read
+   * of one byte.
+   */
+  virtual bool probe(uint8_t i2cAddress);
+
+  /**
+   * Issue all reads in a single I2C_RDWR transaction
+   *
+   * If the adapter supports I2C_FUNC_PROTOCOL_MANGLING, a device that does not
+   * respond doesn't abort the transaction: its read returns the idle bus level
+   * and fails the CRC check of the words, so the read is reported as failed.
+   *
+   * Otherwise the first device that does not respond aborts the transaction,
+   * and the kernel doesn't report which one it was. Each read is then retried
+   * on its own. The sensors drop a result once it is read, so the results of
+   * the devices before the failing one are lost and only those after it are
+   * recovered.
+   */
+  virtual uint8_t readBatch(ReadTransfer *transfers, uint8_t count);
+
+  /** Maximum number of reads issued in one transaction by readBatch() */
+  static const uint8_t MAX_BATCH_READS = 32;
+
+protected:
+  /**
+   * Issue the `count' `messages' as a single I2C_RDWR transaction
+   * Returns true if all messages were transferred. Override this to run the
+   * bus against a simulated device instead of the kernel.
+   */
+  virtual bool transfer(struct i2c_msg *messages, uint32_t count);
+
+  const char *mDevice;
+  int mFd;
+  /** I2C_FUNC_* flags of the adapter, read by begin() */
+  unsigned long mFunctionality;
+
+private:
+  /** Returns true if all words of `transfer' match their CRC */
+  static bool checkWords(const ReadTransfer &transfer);
+};
+
+#endif /* __linux__ && !ARDUINO */
+
+#endif /* SHTLINUXI2CBUS_H */
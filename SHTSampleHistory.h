@@ -0,0 +1,297 @@
+/*
+ *  Copyright (c) 2018, Sensirion AG
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *      * Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright
+ *        notice, this list of conditions and the following disclaimer in the
+ *        documentation and/or other materials provided with the distribution.
+ *      * Neither the name of the Sensirion AG nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SHTSAMPLEHISTORY_H
+#define SHTSAMPLEHISTORY_H
+
+#include <inttypes.h>
+
+#include "SHTSensor.h"
+
+/** Raw sample with the time at which it was read */
+struct SHTTimestampedSample {
+  /** SHTClock::millis() or SHTClock::micros() when the sample was read */
+  unsigned long timestamp;
+  SHTSensorBase::SHTRawSample sample;
+};
+
+/** Clock function used for the timestamps of an SHTSampleHistory */
+enum SHTTimestampUnit {
+  SHT_TIMESTAMP_MILLIS,
+  SHT_TIMESTAMP_MICROS
+};
+
+/**
+ * Read-only view of consecutive samples of an SHTSampleHistory, oldest first
+ *
+ * The samples are not copied: the view refers to the buffer of the history
+ * and is only valid until the history stores its next sample.
+ */
+class SHTSampleView
+{
+public:
+  /** Iterator over the samples of a view, oldest first */
+  class Iterator
+  {
+  public:
+    Iterator(const SHTTimestampedSample *buffer, uint16_t capacity,
+             uint16_t slot, uint16_t step)
+        : mBuffer(buffer), mCapacity(capacity), mSlot(slot), mStep(step)
+    {
+    }
+
+    const SHTTimestampedSample &operator*() const {
+      return mBuffer[mSlot];
+    }
+
+    const SHTTimestampedSample *operator->() const {
+      return &mBuffer[mSlot];
+    }
+
+    Iterator &operator++() {
+      if (++mSlot == mCapacity) {
+        mSlot = 0;
+      }
+      ++mStep;
+      return *this;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return mStep == other.mStep;
+    }
+
+    bool operator!=(const Iterator &other) const {
+      return mStep != other.mStep;
+    }
+
+  private:
+    const SHTTimestampedSample *mBuffer;
+    uint16_t mCapacity;
+    uint16_t mSlot;
+    /** Position within the view, to tell the end from the begin of a full ring */
+    uint16_t mStep;
+  };
+
+  SHTSampleView(const SHTTimestampedSample *buffer, uint16_t capacity,
+                uint16_t first, uint16_t count)
+      : mBuffer(buffer), mCapacity(capacity), mFirst(first), mCount(count)
+  {
+  }
+
+  /** Number of samples in the view */
+  uint16_t size() const {
+    return mCount;
+  }
+
+  bool empty() const {
+    return mCount == 0;
+  }
+
+  /** Sample `index' of the view, 0 being the oldest; `index' must be < size() */
+  const SHTTimestampedSample &operator[](uint16_t index) const {
+    uint16_t slot = mFirst + index;
+    if (slot >= mCapacity) {
+      slot -= mCapacity;
+    }
+    return mBuffer[slot];
+  }
+
+  Iterator begin() const {
+    return Iterator(mBuffer, mCapacity, mFirst, 0);
+  }
+
+  Iterator end() const {
+    return Iterator(mBuffer, mCapacity, mFirst, mCount);
+  }
+
+private:
+  const SHTTimestampedSample *mBuffer;
+  uint16_t mCapacity;
+  uint16_t mFirst;
+  uint16_t mCount;
+};
+
+/**
+ * Ring buffer of the last `Capacity' samples read by an SHTSensor
+ *
+ * Every successful read stores the raw values and a timestamp; once the
+ * buffer is full, the oldest sample is overwritten. The buffer is
+ * part of the object, no memory is allocated. Convert the raw values with the
+ * sensor that read them, e.g. sht.convertTemperature(entry.sample.temperature).
+ *
+ * Example usage:
+ * SHTSensor sht;
+ * SHTSampleHistory<60> history;
+ * ...
+ * sht.addSampleSink(history);
+ * ...
+ * for (SHTSampleView::Iterator it = history.latest(10).begin();
+ *      it != history.latest(10).end(); ++it) {
+ *   Serial.println(sht.convertTemperature(it->sample.temperature));
+ * }
+ */
+template <uint16_t Capacity,
+          SHTTimestampUnit Unit = SHT_TIMESTAMP_MILLIS>
+class SHTSampleHistory : public SHTSampleSink
+{
+public:
+  SHTSampleHistory()
+      : mNext(0), mCount(0)
+  {
+  }
+
+  virtual void addSample(const SHTSensor & /* sensor */,
+                         const SHTSensorBase::SHTRawSample &sample) {
+    SHTClock &clock = SHTClock::getCurrent();
+    SHTTimestampedSample &entry = mBuffer[mNext];
+    entry.timestamp = Unit == SHT_TIMESTAMP_MICROS ? clock.micros()
+                                                   : clock.millis();
+    entry.sample = sample;
+    if (++mNext == Capacity) {
+      mNext = 0;
+    }
+    if (mCount < Capacity) {
+      ++mCount;
+    }
+  }
+
+  /** Maximum number of samples kept */
+  static uint16_t capacity() {
+    return Capacity;
+  }
+
+  /** Number of samples kept */
+  uint16_t size() const {
+    return mCount;
+  }
+
+  bool empty() const {
+    return mCount == 0;
+  }
+
+  bool full() const {
+    return mCount == Capacity;
+  }
+
+  /** Forget all samples */
+  void clear() {
+    mNext = 0;
+    mCount = 0;
+  }
+
+  /**
+   * The most recent sample; only valid if the history is not empty
+   */
+  const SHTTimestampedSample &newest() const {
+    return mBuffer[mNext ? mNext - 1 : Capacity - 1];
+  }
+
+  /** All samples kept, oldest first */
+  SHTSampleView all() const {
+    return latest(mCount);
+  }
+
+  /** The `count' most recent samples, or fewer if less are kept, oldest first */
+  SHTSampleView latest(uint16_t count) const {
+    if (count > mCount) {
+      count = mCount;
+    }
+    uint16_t first = mNext >= count ? mNext - count
+                                    : mNext + Capacity - count;
+    return SHTSampleView(mBuffer, Capacity, first, count);
+  }
+
+private:
+  SHTTimestampedSample mBuffer[Capacity];
+  /** Slot the next sample is stored in */
+  uint16_t mNext;
+  uint16_t mCount;
+};
+
+/**
+ * SHTSensor keeping the history of its last `Capacity' samples
+ *
+ * Example usage:
+ * SHTSensorWithHistory<60> sht;
+ * ...
+ * sht.readSample();
+ * ...
+ * SHTSampleView lastTen = sht.getHistory().latest(10);
+ */
+template <uint16_t Capacity,
+          SHTTimestampUnit Unit = SHT_TIMESTAMP_MILLIS>
+class SHTSensorWithHistory : public SHTSensor
+{
+public:
+  /** See SHTSensor::SHTSensor(SHTSensorType, uint8_t) */
+  SHTSensorWithHistory(SHTSensorType sensorType = AUTO_DETECT,
+                       uint8_t i2cAddress = 0)
+      : SHTSensor(sensorType, i2cAddress)
+  {
+    addSampleSink(mHistory);
+  }
+
+  /** See SHTSensor::SHTSensor(SHTI2cBus &, SHTSensorType, uint8_t) */
+  SHTSensorWithHistory(SHTI2cBus &bus, SHTSensorType sensorType = AUTO_DETECT,
+                       uint8_t i2cAddress = 0)
+      : SHTSensor(bus, sensorType, i2cAddress)
+  {
+    addSampleSink(mHistory);
+  }
+
+  /** See SHTSensor::SHTSensor(const SHTSensorInfo &) */
+  SHTSensorWithHistory(const SHTSensorInfo &info)
+      : SHTSensor(info)
+  {
+    addSampleSink(mHistory);
+  }
+
+  /** See SHTSensor::SHTSensor(SHTI2cBus &, const SHTSensorInfo &) */
+  SHTSensorWithHistory(SHTI2cBus &bus, const SHTSensorInfo &info)
+      : SHTSensor(bus, info)
+  {
+    addSampleSink(mHistory);
+  }
+
+  virtual ~SHTSensorWithHistory() {
+    // mHistory is destroyed before ~SHTSensor() releases its sinks
+    removeSampleSink(mHistory);
+  }
+
+  SHTSampleHistory<Capacity, Unit> &getHistory() {
+    return mHistory;
+  }
+
+  const SHTSampleHistory<Capacity, Unit> &getHistory() const {
+    return mHistory;
+  }
+
+private:
+  SHTSampleHistory<Capacity, Unit> mHistory;
+};
+
+#endif /* SHTSAMPLEHISTORY_H */
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (c) 2018, Sensirion AG
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *      * Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright
+ *        notice, this list of conditions and the following disclaimer in the
+ *        documentation and/or other materials provided with the distribution.
+ *      * Neither the name of the Sensirion AG nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "SHTSampleStatistics.h"
+
+
+//
+// class SHTWindowedStatistics
+//
+
+void SHTWindowedStatistics::convertWindow(const SHTSensor &sensor,
+                                          const RawWindow &raw,
+                                          SHTWindowStatistics &window)
+{
+  SHTValueStatistics *values[2] = { &window.temperature, &window.humidity };
+  for (uint8_t i = 0; i < 2; ++i) {
+    // the conversions are linear, so two points give offset and scale
+    float offset = i ? sensor.convertHumidity(0) : sensor.convertTemperature(0);
+    float scale = ((i ? sensor.convertHumidity(0xffff)
+                      : sensor.convertTemperature(0xffff)) - offset) / 0xffff;
+    values[i]->min = offset + scale * raw.min[i];
+    values[i]->max = offset + scale * raw.max[i];
+    values[i]->mean = offset + scale * raw.mean[i];
+    values[i]->variance = scale * scale * raw.variance[i];
+  }
+  window.count = raw.count;
+  window.start = raw.start;
+  window.end = raw.end;
+}
+
+
+//
+// class SHTTumblingStatistics
+//
+
+void SHTTumblingStatistics::addSample(const SHTSensor &sensor,
+                                      const SHTSensorBase::SHTRawSample &sample)
+{
+  unsigned long now = SHTClock::getCurrent().millis();
+  uint32_t count = mRunning[0].count();
+
+  if (count == 0) {
+    mWindowStart = now;
+  } else if (now - mWindowStart >= mWindowMillis) {
+    for (uint8_t i = 0; i < 2; ++i) {
+      mCurrent.mean[i] = mRunning[i].mean();
+      mCurrent.variance[i] = mRunning[i].variance();
+    }
+    mCurrent.count = count;
+    convertWindow(sensor, mCurrent, mWindow);
+    mHasWindow = true;
+    // windows stay aligned, skipping those without samples
+    mWindowStart += (now - mWindowStart) / mWindowMillis * mWindowMillis;
+    count = 0;
+  }
+
+  const uint16_t values[2] = { sample.temperature, sample.humidity };
+  for (uint8_t i = 0; i < 2; ++i) {
+    if (count == 0) {
+      mRunning[i].clear();
+      mCurrent.min[i] = values[i];
+      mCurrent.max[i] = values[i];
+    } else if (values[i] < mCurrent.min[i]) {
+      mCurrent.min[i] = values[i];
+    } else if (values[i] > mCurrent.max[i]) {
+      mCurrent.max[i] = values[i];
+    }
+    mRunning[i].add(values[i]);
+  }
+  if (count == 0) {
+    mCurrent.start = now;
+  }
+  mCurrent.end = now;
+}
+
+bool SHTTumblingStatistics::takeWindow(SHTWindowStatistics &window)
+{
+  if (!mHasWindow) {
+    return false;
+  }
+  window = mWindow;
+  mHasWindow = false;
+  return true;
+}
+
+void SHTTumblingStatistics::clear()
+{
+  for (uint8_t i = 0; i < 2; ++i) {
+    mRunning[i].clear();
+  }
+  mWindowStart = 0;
+  mHasWindow = false;
+}
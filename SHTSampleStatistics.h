@@ -0,0 +1,357 @@
+/*
+ *  Copyright (c) 2018, Sensirion AG
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *      * Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright
+ *        notice, this list of conditions and the following disclaimer in the
+ *        documentation and/or other materials provided with the distribution.
+ *      * Neither the name of the Sensirion AG nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SHTSAMPLESTATISTICS_H
+#define SHTSAMPLESTATISTICS_H
+
+#include <inttypes.h>
+
+#include "SHTSensor.h"
+#include "SHTSampleHistory.h"
+
+/** Statistics of one quantity over a window, in degrees Celsius or percent */
+struct SHTValueStatistics {
+  float min;
+  float max;
+  float mean;
+  /** Population variance, in degrees Celsius squared or percent squared */
+  float variance;
+};
+
+/** Statistics of the samples of a window */
+struct SHTWindowStatistics {
+  /** Number of samples in the window */
+  uint32_t count;
+  /** SHTClock::millis() of the first and the last sample of the window */
+  unsigned long start;
+  unsigned long end;
+  SHTValueStatistics temperature;
+  SHTValueStatistics humidity;
+};
+
+/**
+ * Running mean and variance of raw values using Welford's algorithm
+ *
+ * Values are added in constant time; the mean and the sum of squared
+ * deviations are kept in raw ticks.
+ */
+class SHTRunningStatistics
+{
+public:
+  SHTRunningStatistics()
+      : mCount(0), mMean(0), mSquaredDeviations(0)
+  {
+  }
+
+  void clear() {
+    mCount = 0;
+    mMean = 0;
+    mSquaredDeviations = 0;
+  }
+
+  void add(uint16_t value) {
+    ++mCount;
+    float delta = value - mMean;
+    mMean += delta / mCount;
+    mSquaredDeviations += delta * (value - mMean);
+  }
+
+  uint32_t count() const {
+    return mCount;
+  }
+
+  /** Mean in raw ticks */
+  float mean() const {
+    return mMean;
+  }
+
+  /** Population variance in raw ticks squared */
+  float variance() const {
+    return mCount ? mSquaredDeviations / mCount : 0;
+  }
+
+private:
+  // tumbling windows have no sample limit
+  uint32_t mCount;
+  float mMean;
+  float mSquaredDeviations;
+};
+
+/**
+ * Base of the sample sinks computing statistics over windows of samples
+ *
+ * The statistics are accumulated on the raw values; they are converted to
+ * physical units once per window, with the conversion of the sensor that read
+ * the samples.
+ */
+class SHTWindowedStatistics : public SHTSampleSink
+{
+protected:
+  /** Raw statistics of a window; index 0 is the temperature, 1 the humidity */
+  struct RawWindow {
+    uint16_t min[2];
+    uint16_t max[2];
+    /** Mean in raw ticks */
+    float mean[2];
+    /** Population variance in raw ticks squared */
+    float variance[2];
+    uint32_t count;
+    unsigned long start;
+    unsigned long end;
+  };
+
+  /** Convert `raw' to `window' with the conversion functions of `sensor' */
+  static void convertWindow(const SHTSensor &sensor, const RawWindow &raw,
+                            SHTWindowStatistics &window);
+};
+
+/**
+ * Statistics over consecutive windows of fixed duration
+ *
+ * A window ends when a sample arrives `windowMillis' or more after the start
+ * of the window; windows without samples are skipped. A `windowMillis' of 0
+ * is taken as 1. Each update takes constant time and no samples are stored.
+ *
+ * Example usage:
+ * SHTTumblingStatistics minute(60000);
+ * sht.addSampleSink(minute);
+ * ...
+ * SHTWindowStatistics window;
+ * if (sht.readSample() && minute.takeWindow(window)) {
+ *   Serial.println(window.temperature.mean);
+ * }
+ */
+class SHTTumblingStatistics : public SHTWindowedStatistics
+{
+public:
+  SHTTumblingStatistics(unsigned long windowMillis)
+      : mWindowMillis(windowMillis ? windowMillis : 1), mHasWindow(false)
+  {
+    clear();
+  }
+
+  virtual void addSample(const SHTSensor &sensor,
+                         const SHTSensorBase::SHTRawSample &sample);
+
+  /**
+   * Get the statistics of the last completed window
+   * Returns true once per completed window, false if no window completed
+   * since the last call
+   */
+  bool takeWindow(SHTWindowStatistics &window);
+
+  /** Forget the current window and the completed one not taken yet */
+  void clear();
+
+private:
+  unsigned long mWindowMillis;
+  /** Minimum, maximum and times of the current window */
+  RawWindow mCurrent;
+  /** Mean and variance of the current window */
+  SHTRunningStatistics mRunning[2];
+  /** Start of the current window, which is aligned to mWindowMillis */
+  unsigned long mWindowStart;
+  /** Completed window, valid if mHasWindow */
+  SHTWindowStatistics mWindow;
+  bool mHasWindow;
+};
+
+/**
+ * Statistics over the last `Capacity' samples
+ *
+ * Each new sample replaces the oldest one in the window. The sums of the
+ * values and of their squares are kept as integers, so removing the oldest
+ * sample is exact and the mean and the variance are updated in constant
+ * time; the minimum and maximum in amortized constant time through monotonic
+ * queues. Needs about 16 bytes of RAM per sample on 8 bit boards.
+ *
+ * Example usage:
+ * SHTSlidingStatistics<60> lastMinute;
+ * sht.addSampleSink(lastMinute);
+ * ...
+ * SHTWindowStatistics window;
+ * if (lastMinute.getWindow(window)) {
+ *   Serial.println(window.humidity.max);
+ * }
+ */
+template <uint16_t Capacity>
+class SHTSlidingStatistics : public SHTWindowedStatistics
+{
+public:
+  SHTSlidingStatistics()
+      : mNext(0), mCount(0)
+  {
+    clear();
+  }
+
+  virtual void addSample(const SHTSensor & /* sensor */,
+                         const SHTSensorBase::SHTRawSample &sample) {
+    const uint16_t values[2] = { sample.temperature, sample.humidity };
+    if (mCount == Capacity) {
+      // the new sample replaces the oldest one, which is in slot mNext
+      for (uint8_t i = 0; i < 2; ++i) {
+        uint16_t oldest = value(mNext, i);
+        mSum[i] -= oldest;
+        mSumOfSquares[i] -= (uint32_t)oldest * oldest;
+        mMin[i].expire(mNext);
+        mMax[i].expire(mNext);
+      }
+    } else {
+      ++mCount;
+    }
+
+    SHTTimestampedSample &entry = mSamples[mNext];
+    entry.timestamp = SHTClock::getCurrent().millis();
+    entry.sample = sample;
+    for (uint8_t i = 0; i < 2; ++i) {
+      mSum[i] += values[i];
+      mSumOfSquares[i] += (uint32_t)values[i] * values[i];
+      push(mMin[i], mNext, i, false);
+      push(mMax[i], mNext, i, true);
+    }
+
+    if (++mNext == Capacity) {
+      mNext = 0;
+    }
+  }
+
+  /**
+   * Get the statistics of the samples in the window, converted with the
+   * sensor the statistics are attached to
+   * Returns false if there are none or the statistics are not attached
+   */
+  bool getWindow(SHTWindowStatistics &window) const {
+    const SHTSensor *sensor = getOwner();
+    if (mCount == 0 || !sensor) {
+      return false;
+    }
+    RawWindow raw;
+    for (uint8_t i = 0; i < 2; ++i) {
+      raw.min[i] = value(mMin[i].front(), i);
+      raw.max[i] = value(mMax[i].front(), i);
+      raw.mean[i] = (float)mSum[i] / mCount;
+      // n * sum(x^2) - sum(x)^2 is exact, and fits into 64 bits for up to
+      // 65535 values of 16 bits
+      uint64_t deviations = (uint64_t)mCount * mSumOfSquares[i] -
+                            (uint64_t)mSum[i] * mSum[i];
+      raw.variance[i] = (float)deviations / ((float)mCount * mCount);
+    }
+    raw.count = mCount;
+    uint16_t oldest = mCount == Capacity ? mNext : 0;
+    raw.start = mSamples[oldest].timestamp;
+    raw.end = mSamples[mNext ? mNext - 1 : Capacity - 1].timestamp;
+    convertWindow(*sensor, raw, window);
+    return true;
+  }
+
+  /** Number of samples in the window */
+  uint16_t size() const {
+    return mCount;
+  }
+
+  /** Forget all samples */
+  void clear() {
+    mNext = 0;
+    mCount = 0;
+    for (uint8_t i = 0; i < 2; ++i) {
+      mSum[i] = 0;
+      mSumOfSquares[i] = 0;
+      mMin[i].clear();
+      mMax[i].clear();
+    }
+  }
+
+private:
+  /**
+   * Slots of the samples that can still become the minimum (or maximum) of
+   * the window, oldest first, with increasing (or decreasing) values
+   */
+  struct MonotonicQueue {
+    uint16_t slots[Capacity];
+    uint16_t head;
+    uint16_t size;
+
+    void clear() {
+      head = 0;
+      size = 0;
+    }
+
+    uint16_t front() const {
+      return slots[head];
+    }
+
+    uint16_t back() const {
+      uint16_t index = head + size - 1;
+      return slots[index >= Capacity ? index - Capacity : index];
+    }
+
+    void pushBack(uint16_t slot) {
+      uint16_t index = head + size;
+      slots[index >= Capacity ? index - Capacity : index] = slot;
+      ++size;
+    }
+
+    /** Drop `slot' if it is the oldest entry, as its sample leaves the window */
+    void expire(uint16_t slot) {
+      if (size && slots[head] == slot) {
+        if (++head == Capacity) {
+          head = 0;
+        }
+        --size;
+      }
+    }
+  };
+
+  uint16_t value(uint16_t slot, uint8_t index) const {
+    const SHTSensorBase::SHTRawSample &sample = mSamples[slot].sample;
+    return index ? sample.humidity : sample.temperature;
+  }
+
+  void push(MonotonicQueue &queue, uint16_t slot, uint8_t index,
+            bool maximum) {
+    uint16_t v = value(slot, index);
+    // samples older than `slot' and not smaller (or larger) can no longer
+    // become the minimum (or maximum)
+    while (queue.size &&
+           (maximum ? value(queue.back(), index) <= v
+                    : value(queue.back(), index) >= v)) {
+      --queue.size;
+    }
+    queue.pushBack(slot);
+  }
+
+  SHTTimestampedSample mSamples[Capacity];
+  uint16_t mNext;
+  uint16_t mCount;
+  /** Sums of the raw values of the window and of their squares */
+  uint32_t mSum[2];
+  uint64_t mSumOfSquares[2];
+  MonotonicQueue mMin[2];
+  MonotonicQueue mMax[2];
+};
+
+#endif /* SHTSAMPLESTATISTICS_H */
@@ -27,11 +27,183 @@
  */
 
 #include <inttypes.h>
+#include <string.h>
+#ifdef ARDUINO
 #include <Wire.h>
 #include <Arduino.h>
+#else
+#include <math.h>
+#include <time.h>
+#endif
 
 #include "SHTSensor.h"
 
+#ifndef ARDUINO
+
+//
+// Arduino API replacements for host builds
+//
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+#endif /* ARDUINO */
+
+#if SHT_STATISTICS
+// count an event in the statistics of the sensor owning a driver, if any
+#define SHT_COUNT(counter) \
+  do { if (mStatistics) { ++mStatistics->counter; } } while (0)
+#else
+#define SHT_COUNT(counter) do { } while (0)
+#endif
+
+
+//
+// class SHTClock
+//
+
+/** SHTClock on the Arduino timing functions or the host monotonic clock */
+class SHTSystemClock : public SHTClock
+{
+public:
+#ifdef ARDUINO
+  virtual unsigned long millis() {
+    return ::millis();
+  }
+
+  virtual unsigned long micros() {
+    return ::micros();
+  }
+
+  virtual void delay(unsigned long ms) {
+    ::delay(ms);
+  }
+
+  virtual void delayMicroseconds(unsigned int us) {
+    ::delayMicroseconds(us);
+  }
+#else
+  // both wrap around like on Arduino, millis() after 49.7 days rather than
+  // with micros() after 71.6 minutes if unsigned long has 32 bits
+  virtual unsigned long millis() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000UL + now.tv_nsec / 1000000;
+  }
+
+  virtual unsigned long micros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+  }
+
+  virtual void delay(unsigned long ms) {
+    sleep(ms / 1000, (ms % 1000) * 1000000L);
+  }
+
+  virtual void delayMicroseconds(unsigned int us) {
+    sleep(us / 1000000, (us % 1000000) * 1000L);
+  }
+
+private:
+  static void sleep(time_t seconds, long nanoseconds) {
+    struct timespec duration;
+    duration.tv_sec = seconds;
+    duration.tv_nsec = nanoseconds;
+    while (nanosleep(&duration, &duration) != 0) {
+      // interrupted by a signal, sleep for the remaining time
+    }
+  }
+#endif /* ARDUINO */
+};
+
+static SHTSystemClock systemClock;
+static SHTClock *currentClock = &systemClock;
+
+SHTClock &SHTClock::getCurrent()
+{
+  return *currentClock;
+}
+
+void SHTClock::setCurrent(SHTClock *clock)
+{
+  currentClock = clock ? clock : &systemClock;
+}
+
+/**
+ * Wait `us' microseconds on the current clock. Long waits use delay(), as
+ * the Arduino delayMicroseconds() is only accurate up to about 16 ms.
+ */
+static void waitMicroseconds(unsigned long us)
+{
+  SHTClock &clock = SHTClock::getCurrent();
+  if (us >= 1000) {
+    clock.delay(us / 1000);
+  }
+  clock.delayMicroseconds(us % 1000);
+}
+
+
+//
+// class SHTI2cBus
+//
+
+#ifdef ARDUINO
+static SHTWireBus defaultBus(Wire);
+
+SHTI2cBus *SHTI2cBus::getDefault()
+{
+  return &defaultBus;
+}
+
+SHTWireBus *SHTWireBus::getDefault()
+{
+  return &defaultBus;
+}
+#else
+SHTI2cBus *SHTI2cBus::getDefault()
+{
+  return NULL;
+}
+#endif /* ARDUINO */
+
+
+#ifdef ARDUINO
+
+//
+// class SHTWireBus
+//
+
+bool SHTWireBus::write(uint8_t i2cAddress, const uint8_t *data,
+                       uint8_t length)
+{
+  mWire.beginTransmission(i2cAddress);
+  for (int i = 0; i < length; ++i) {
+    if (mWire.write(data[i]) != 1) {
+      return false;
+    }
+  }
+
+  return mWire.endTransmission() == 0;
+}
+
+bool SHTWireBus::read(uint8_t i2cAddress, uint8_t *data, uint8_t length)
+{
+  mWire.requestFrom(i2cAddress, length);
+
+  // check if the same number of bytes are received that are requested.
+  if (mWire.available() != length) {
+    return false;
+  }
+
+  for (int i = 0; i < length; ++i) {
+    data[i] = mWire.read();
+  }
+  return true;
+}
+
+#endif /* ARDUINO */
+
 
 //
 // class SHTSensorDriver
@@ -46,6 +218,20 @@ bool SHTSensorDriver::readSample()
   return false;
 }
 
+void SHTSensorDriver::convertSamples(const SHTSensorBase::SHTRawSample *samples,
+                                     uint16_t count, float *temperatures,
+                                     float *humidities) const
+{
+  for (uint16_t i = 0; i < count; ++i) {
+    if (temperatures) {
+      temperatures[i] = convertTemperature(samples[i].temperature);
+    }
+    if (humidities) {
+      humidities[i] = convertHumidity(samples[i].humidity);
+    }
+  }
+}
+
 
 //
 // class SHTI2cSensor
@@ -53,34 +239,87 @@ bool SHTSensorDriver::readSample()
 
 const uint8_t SHTI2cSensor::EXPECTED_DATA_SIZE   = 6;
 
-bool SHTI2cSensor::readFromI2c(uint8_t i2cAddress,
+#if SHT_CRC8_IMPL == SHT_CRC8_NIBBLE_TABLE
+
+// CRC8 (polynomial 0x31) of the upper nibble, indexed by the nibble
+static const uint8_t CRC8_NIBBLE_TABLE[16] PROGMEM = {
+  0x00, 0x31, 0x62, 0x53, 0xc4, 0xf5, 0xa6, 0x97,
+  0xb9, 0x88, 0xdb, 0xea, 0x7d, 0x4c, 0x1f, 0x2e
+};
+
+#elif SHT_CRC8_IMPL == SHT_CRC8_BYTE_TABLE
+
+// CRC8 (polynomial 0x31) of a byte, indexed by the byte
+static const uint8_t CRC8_BYTE_TABLE[256] PROGMEM = {
+  0x00, 0x31, 0x62, 0x53, 0xc4, 0xf5, 0xa6, 0x97,
+  0xb9, 0x88, 0xdb, 0xea, 0x7d, 0x4c, 0x1f, 0x2e,
+  0x43, 0x72, 0x21, 0x10, 0x87, 0xb6, 0xe5, 0xd4,
+  0xfa, 0xcb, 0x98, 0xa9, 0x3e, 0x0f, 0x5c, 0x6d,
+  0x86, 0xb7, 0xe4, 0xd5, 0x42, 0x73, 0x20, 0x11,
+  0x3f, 0x0e, 0x5d, 0x6c, 0xfb, 0xca, 0x99, 0xa8,
+  0xc5, 0xf4, 0xa7, 0x96, 0x01, 0x30, 0x63, 0x52,
+  0x7c, 0x4d, 0x1e, 0x2f, 0xb8, 0x89, 0xda, 0xeb,
+  0x3d, 0x0c, 0x5f, 0x6e, 0xf9, 0xc8, 0x9b, 0xaa,
+  0x84, 0xb5, 0xe6, 0xd7, 0x40, 0x71, 0x22, 0x13,
+  0x7e, 0x4f, 0x1c, 0x2d, 0xba, 0x8b, 0xd8, 0xe9,
+  0xc7, 0xf6, 0xa5, 0x94, 0x03, 0x32, 0x61, 0x50,
+  0xbb, 0x8a, 0xd9, 0xe8, 0x7f, 0x4e, 0x1d, 0x2c,
+  0x02, 0x33, 0x60, 0x51, 0xc6, 0xf7, 0xa4, 0x95,
+  0xf8, 0xc9, 0x9a, 0xab, 0x3c, 0x0d, 0x5e, 0x6f,
+  0x41, 0x70, 0x23, 0x12, 0x85, 0xb4, 0xe7, 0xd6,
+  0x7a, 0x4b, 0x18, 0x29, 0xbe, 0x8f, 0xdc, 0xed,
+  0xc3, 0xf2, 0xa1, 0x90, 0x07, 0x36, 0x65, 0x54,
+  0x39, 0x08, 0x5b, 0x6a, 0xfd, 0xcc, 0x9f, 0xae,
+  0x80, 0xb1, 0xe2, 0xd3, 0x44, 0x75, 0x26, 0x17,
+  0xfc, 0xcd, 0x9e, 0xaf, 0x38, 0x09, 0x5a, 0x6b,
+  0x45, 0x74, 0x27, 0x16, 0x81, 0xb0, 0xe3, 0xd2,
+  0xbf, 0x8e, 0xdd, 0xec, 0x7b, 0x4a, 0x19, 0x28,
+  0x06, 0x37, 0x64, 0x55, 0xc2, 0xf3, 0xa0, 0x91,
+  0x47, 0x76, 0x25, 0x14, 0x83, 0xb2, 0xe1, 0xd0,
+  0xfe, 0xcf, 0x9c, 0xad, 0x3a, 0x0b, 0x58, 0x69,
+  0x04, 0x35, 0x66, 0x57, 0xc0, 0xf1, 0xa2, 0x93,
+  0xbd, 0x8c, 0xdf, 0xee, 0x79, 0x48, 0x1b, 0x2a,
+  0xc1, 0xf0, 0xa3, 0x92, 0x05, 0x34, 0x67, 0x56,
+  0x78, 0x49, 0x1a, 0x2b, 0xbc, 0x8d, 0xde, 0xef,
+  0x82, 0xb3, 0xe0, 0xd1, 0x46, 0x77, 0x24, 0x15,
+  0x3b, 0x0a, 0x59, 0x68, 0xff, 0xce, 0x9d, 0xac
+};
+
+#endif
+
+bool SHTI2cSensor::readFromI2c(SHTI2cBus &bus, uint8_t i2cAddress,
                                const uint8_t *i2cCommand,
                                uint8_t commandLength, uint8_t *data,
                                uint8_t dataLength,
-                               uint8_t duration)
+                               uint16_t duration)
 {
-  Wire.beginTransmission(i2cAddress);
-  for (int i = 0; i < commandLength; ++i) {
-    if (Wire.write(i2cCommand[i]) != 1) {
-      return false;
-    }
+  if (duration == 0) {
+    return bus.writeRead(i2cAddress, i2cCommand, commandLength,
+                         data, dataLength);
   }
 
-  if (Wire.endTransmission() != 0) {
+  if (!bus.write(i2cAddress, i2cCommand, commandLength)) {
     return false;
   }
 
-  delay(duration);
+  waitMicroseconds(duration);
 
-  Wire.requestFrom(i2cAddress, dataLength);
+  return bus.read(i2cAddress, data, dataLength);
+}
 
-  // check if the same number of bytes are received that are requested.
-  if (Wire.available() != dataLength) {
+bool SHTI2cSensor::readWords(SHTI2cBus &bus, uint8_t i2cAddress,
+                             const uint8_t *i2cCommand,
+                             uint8_t commandLength, uint8_t *data,
+                             uint8_t dataLength, uint16_t duration)
+{
+  if (!readFromI2c(bus, i2cAddress, i2cCommand, commandLength, data,
+                   dataLength, duration)) {
     return false;
   }
-
-  for (int i = 0; i < dataLength; ++i) {
-    data[i] = Wire.read();
+  for (uint8_t i = 0; i + 2 < dataLength; i += 3) {
+    if (crc8(&data[i], 2) != data[i + 2]) {
+      return false;
+    }
   }
   return true;
 }
@@ -94,6 +333,12 @@ uint8_t SHTI2cSensor::crc8(const uint8_t *data, uint8_t len)
   uint8_t byteCtr;
   for (byteCtr = 0; byteCtr < len; ++byteCtr) {
     crc ^= data[byteCtr];
+#if SHT_CRC8_IMPL == SHT_CRC8_NIBBLE_TABLE
+    crc = (crc << 4) ^ pgm_read_byte(&CRC8_NIBBLE_TABLE[crc >> 4]);
+    crc = (crc << 4) ^ pgm_read_byte(&CRC8_NIBBLE_TABLE[crc >> 4]);
+#elif SHT_CRC8_IMPL == SHT_CRC8_BYTE_TABLE
+    crc = pgm_read_byte(&CRC8_BYTE_TABLE[crc]);
+#else
     for (uint8_t bit = 8; bit > 0; --bit) {
       if (crc & 0x80) {
         crc = (crc << 1) ^ 0x31;
@@ -101,245 +346,853 @@ uint8_t SHTI2cSensor::crc8(const uint8_t *data, uint8_t len)
         crc = (crc << 1);
       }
     }
+#endif
   }
   return crc;
 }
 
+void SHTI2cSensor::encodeCommand(uint16_t command, uint8_t *cmd)
+{
+  cmd[0] = command >> 8;
+  //is omitted for SHT4x Sensors
+  cmd[1] = command & 0xff;
+}
 
-bool SHTI2cSensor::readSample()
+bool SHTI2cSensor::sendCommand(uint16_t command)
 {
-  uint8_t data[EXPECTED_DATA_SIZE];
-  uint8_t cmd[mCmd_Size];
+  uint8_t cmd[2];
+  encodeCommand(command, cmd);
+  return mBus.write(mI2cAddress, cmd, mCmd_Size);
+}
 
-  cmd[0] = mI2cCommand >> 8;
-  //is omitted for SHT4x Sensors
-  cmd[1] = mI2cCommand & 0xff;
+bool SHTI2cSensor::startMeasurement()
+{
+  mResultLayout = RESULT_SAMPLE;
+  return sendMeasurementCommand(mI2cCommand);
+}
 
-  if (!readFromI2c(mI2cAddress, cmd, mCmd_Size, data,
-                   EXPECTED_DATA_SIZE, mDuration)) {
+bool SHTI2cSensor::sendMeasurementCommand(uint16_t command)
+{
+  mMeasurementPending = false;
+  if (!sendCommand(command)) {
+    SHT_COUNT(writeNacks);
     return false;
   }
+  mMeasurementStart = SHTClock::getCurrent().micros();
+  mMeasurementPending = true;
+  return true;
+}
 
-  // -- Important: assuming each 2 byte of data is followed by 1 byte of CRC
+bool SHTI2cSensor::isSampleReady() const
+{
+  return mMeasurementPending &&
+      SHTClock::getCurrent().micros() - mMeasurementStart >= mDuration;
+}
 
-  // check CRC for both RH and T
-  if (crc8(&data[0], 2) != data[2] || crc8(&data[3], 2) != data[5]) {
+bool SHTI2cSensor::fetchSample()
+{
+  if (!isSampleReady()) {
     return false;
   }
+  return readMeasurementResult();
+}
 
-  // convert to Temperature/Humidity
-  uint16_t val;
-  val = (data[0] << 8) + data[1];
-  mTemperature = mA + mB * (val / mC);
+SHTI2cBus *SHTI2cSensor::prepareFetch(SHTI2cBus::ReadTransfer &transfer)
+{
+  if (!mMeasurementPending) {
+    return NULL;
+  }
+  transfer.i2cAddress = mI2cAddress;
+  transfer.length = resultLength();
+  return &mBus;
+}
 
-  val = (data[3] << 8) + data[4];
-  mHumidity = mX + mY * (val / mZ);
+bool SHTI2cSensor::completeFetch(const SHTI2cBus::ReadTransfer &transfer)
+{
+  if (!transfer.success) {
+    // before the conversion time has passed the result is just not ready
+    if (isSampleReady()) {
+      SHT_COUNT(shortReads);
+    }
+    mMeasurementPending = false;
+    return false;
+  }
+  mMeasurementPending = false;
+  return processMeasurementResult(transfer.data);
+}
 
-  return true; 
-  
+bool SHTI2cSensor::readSample()
+{
+  return measure(mI2cCommand, RESULT_SAMPLE);
 }
 
-//
-// class SHTC1Sensor
-//
+bool SHTI2cSensor::readTemperatureOnly()
+{
+  return measure(mI2cCommand, RESULT_TEMPERATURE);
+}
 
-class SHTC1Sensor : public SHTI2cSensor
+bool SHTI2cSensor::measure(uint16_t command, ResultLayout layout)
 {
-public:
-    SHTC1Sensor()
-        // clock stretching disabled, high precision, T first
-        : SHTI2cSensor(0x70, 0x7866, 15, -45, 175, 65535, 0, 100, 65535, 2)
-    {
+  mResultLayout = layout;
+  if (mDuration == 0 || mClockStretching) {
+    // no conversion time, e.g. when fetching periodic results, or the sensor
+    // stretches the clock until the result is ready: send the command and
+    // read the result in a single bus transfer
+    uint8_t cmd[2];
+    uint8_t data[EXPECTED_DATA_SIZE];
+    encodeCommand(command, cmd);
+    mMeasurementPending = false;
+    if (!mBus.writeRead(mI2cAddress, cmd, mCmd_Size, data, resultLength())) {
+      SHT_COUNT(shortReads);
+      return false;
     }
-};
+    return processMeasurementResult(data);
+  }
 
+  if (!sendMeasurementCommand(command)) {
+    return false;
+  }
+  if (mLearnDuration) {
+    return pollMeasurementResult(mLearnedDuration ?
+        mLearnedDuration + mLearningMargin : mTypicalDuration);
+  }
+  if (mPollForReady) {
+    return pollMeasurementResult(mTypicalDuration);
+  }
+  waitMicroseconds(mDuration);
+  return readMeasurementResult();
+}
 
-//
-// class SHT3xSensor
-//
+bool SHTI2cSensor::setReadyPolling(bool enable, uint16_t pollInterval,
+                                   uint8_t timeout)
+{
+  mPollForReady = enable;
+  mPollInterval = pollInterval;
+  mPollTimeout = timeout;
+  return true;
+}
 
-class SHT3xSensor : public SHTI2cSensor
+bool SHTI2cSensor::setDurationLearning(bool enable, uint16_t margin)
 {
-private:
-  static const uint16_t SHT3X_ACCURACY_HIGH    = 0x2400;
-  static const uint16_t SHT3X_ACCURACY_MEDIUM  = 0x240b;
-  static const uint16_t SHT3X_ACCURACY_LOW     = 0x2416;
+  mLearnDuration = enable;
+  mLearningMargin = margin;
+  return true;
+}
 
-  static const uint8_t SHT3X_ACCURACY_HIGH_DURATION   = 15;
-  static const uint8_t SHT3X_ACCURACY_MEDIUM_DURATION = 6;
-  static const uint8_t SHT3X_ACCURACY_LOW_DURATION    = 4;
+bool SHTI2cSensor::pollMeasurementResult(uint16_t wait)
+{
+  SHTClock &clock = SHTClock::getCurrent();
+  unsigned long timeout = mPollTimeout ? mPollTimeout * 1000UL : 2UL * mDuration;
+  uint8_t data[EXPECTED_DATA_SIZE];
+  unsigned long readStart;
+  bool late = false;
 
-public:
-  static const uint8_t SHT3X_I2C_ADDRESS_44 = 0x44;
-  static const uint8_t SHT3X_I2C_ADDRESS_45 = 0x45;
-
-  SHT3xSensor(uint8_t i2cAddress = SHT3X_I2C_ADDRESS_44)
-      : SHTI2cSensor(i2cAddress, SHT3X_ACCURACY_HIGH,
-                     SHT3X_ACCURACY_HIGH_DURATION,
-                     -45, 175, 65535, 0, 100, 65535, 2)
-  {
-  }
-
-  virtual bool setAccuracy(SHTSensor::SHTAccuracy newAccuracy)
-  {
-    switch (newAccuracy) {
-      case SHTSensor::SHT_ACCURACY_HIGH:
-        mI2cCommand = SHT3X_ACCURACY_HIGH;
-        mDuration = SHT3X_ACCURACY_HIGH_DURATION;
-        break;
-      case SHTSensor::SHT_ACCURACY_MEDIUM:
-        mI2cCommand = SHT3X_ACCURACY_MEDIUM;
-        mDuration = SHT3X_ACCURACY_MEDIUM_DURATION;
-        break;
-      case SHTSensor::SHT_ACCURACY_LOW:
-        mI2cCommand = SHT3X_ACCURACY_LOW;
-        mDuration = SHT3X_ACCURACY_LOW_DURATION;
-        break;
-      default:
-        return false;
+  waitMicroseconds(wait);
+  // the sensor does not acknowledge its address until the result is ready
+  for (;;) {
+    readStart = clock.micros();
+    if (mBus.read(mI2cAddress, data, resultLength())) {
+      break;
     }
-    return true;
+    if (readStart - mMeasurementStart >= timeout) {
+      mMeasurementPending = false;
+      SHT_COUNT(shortReads);
+      return false;
+    }
+    late = true;
+    waitMicroseconds(mPollInterval);
   }
-};
+  mMeasurementPending = false;
 
+  if (mLearnDuration) {
+    unsigned long ready = readStart - mMeasurementStart;
+    if (late || mLearnedDuration == 0) {
+      // follow late results at once...
+      mLearnedDuration = ready < 0xffff ? ready : 0xffff;
+    } else {
+      // ...and slowly try shorter waits while results are in time
+      mLearnedDuration -= (mLearnedDuration >> 8) + 1;
+    }
+  }
+  return processMeasurementResult(data);
+}
 
-//
-// class SHT4xSensor
-//
-
-class SHT4xSensor : public SHTI2cSensor
+bool SHTI2cSensor::readMeasurementResult()
 {
-private:
-  static const uint16_t SHT4X_ACCURACY_HIGH    = 0xFD00;
-  static const uint16_t SHT4X_ACCURACY_MEDIUM  = 0xF600;
-  static const uint16_t SHT4X_ACCURACY_LOW     = 0xE000;
+  uint8_t data[EXPECTED_DATA_SIZE];
+
+  mMeasurementPending = false;
+  if (!mBus.read(mI2cAddress, data, resultLength())) {
+    SHT_COUNT(shortReads);
+    return false;
+  }
+  return processMeasurementResult(data);
+}
 
-  static const uint8_t SHT4X_ACCURACY_HIGH_DURATION   = 10;
-  static const uint8_t SHT4X_ACCURACY_MEDIUM_DURATION = 4;
-  static const uint8_t SHT4X_ACCURACY_LOW_DURATION    = 2;
+bool SHTI2cSensor::processMeasurementResult(const uint8_t *data)
+{
+  // -- Important: assuming each 2 byte of data is followed by 1 byte of CRC
 
-public:
-  static const uint8_t SHT4X_I2C_ADDRESS_44 = 0x44;
-  static const uint8_t SHT4X_I2C_ADDRESS_45 = 0x45;
-
-  SHT4xSensor(uint8_t i2cAddress = SHT4X_I2C_ADDRESS_44)
-      : SHTI2cSensor(i2cAddress, SHT4X_ACCURACY_HIGH,
-                     SHT4X_ACCURACY_HIGH_DURATION,
-                     -45, 175, 65535, -6, 125, 65535, 1)
-  {
-  }
-
-  virtual bool setAccuracy(SHTSensor::SHTAccuracy newAccuracy)
-  {
-    switch (newAccuracy) {
-      case SHTSensor::SHT_ACCURACY_HIGH:
-        mI2cCommand = SHT4X_ACCURACY_HIGH;
-        mDuration = SHT4X_ACCURACY_HIGH_DURATION;
-        break;
-      case SHTSensor::SHT_ACCURACY_MEDIUM:
-        mI2cCommand = SHT4X_ACCURACY_MEDIUM;
-        mDuration = SHT4X_ACCURACY_MEDIUM_DURATION;
-        break;
-      case SHTSensor::SHT_ACCURACY_LOW:
-        mI2cCommand = SHT4X_ACCURACY_LOW;
-        mDuration = SHT4X_ACCURACY_LOW_DURATION;
-        break;
-      default:
-        return false;
+  // check CRC for both RH and T, or for the single word read
+  bool firstValid = crc8(&data[0], 2) == data[2];
+  bool secondValid = mResultLayout != RESULT_SAMPLE ||
+      crc8(&data[3], 2) == data[5];
+  if (!firstValid || !secondValid) {
+    if (!firstValid) {
+      SHT_COUNT(crcFailures[0]);
     }
+    if (!secondValid) {
+      SHT_COUNT(crcFailures[1]);
+    }
+    return false;
+  }
+
+  // keep the raw values, they are converted when read
+  uint16_t val;
+  val = (data[0] << 8) + data[1];
+  if (mResultLayout == RESULT_HUMIDITY) {
+    mRawHumidity = val;
     return true;
   }
-};
+  mRawTemperature = val;
+  if (mResultLayout == RESULT_TEMPERATURE) {
+    return true;
+  }
+
+  val = (data[3] << 8) + data[4];
+  mRawHumidity = val;
+
+  return true;
+}
 
+void SHTI2cSensor::convertSamples(const SHTSensorBase::SHTRawSample *samples,
+                                  uint16_t count, float *temperatures,
+                                  float *humidities) const
+{
+  // one division per call instead of one per value
+  const float temperatureScale = mB / mC;
+  const float humidityScale = mY / mZ;
+  for (uint16_t i = 0; i < count; ++i) {
+    if (temperatures) {
+      temperatures[i] = mA + samples[i].temperature * temperatureScale;
+    }
+    if (humidities) {
+      humidities[i] = mX + samples[i].humidity * humidityScale;
+    }
+  }
+}
 
 //
-// class SHT3xAnalogSensor
+// class SHTC1Sensor
 //
 
-float SHT3xAnalogSensor::readHumidity()
+bool SHTC1Sensor::setClockStretching(bool enable)
 {
-  float max_adc = (float)((1 << mReadResolutionBits) - 1);
-  return -12.5f + 125 * (analogRead(mHumidityAdcPin) / max_adc);
+  mClockStretching = enable;
+  mI2cCommand = enable ? SHTC1_MEASURE_CLOCK_STRETCHING : SHTC1_MEASURE;
+  mHumidityFirstCommand = enable ?
+      SHTC1_MEASURE_HUMIDITY_FIRST_CLOCK_STRETCHING :
+      SHTC1_MEASURE_HUMIDITY_FIRST;
+  return true;
 }
 
-float SHT3xAnalogSensor::readTemperature()
+bool SHTC1Sensor::readHumidityOnly()
 {
-  float max_adc = (float)((1 << mReadResolutionBits) - 1);
-  return -66.875f + 218.75f * (analogRead(mTemperatureAdcPin) / max_adc);
+  return measure(mHumidityFirstCommand, RESULT_HUMIDITY);
+}
+
+bool SHTC1Sensor::readId(SHTI2cBus &bus, uint16_t &id)
+{
+  // a sleeping SHTC3 ignores everything but the wakeup command, which the
+  // other members of the family don't acknowledge
+  const uint8_t wakeup[] = { SHTC3_WAKEUP >> 8, SHTC3_WAKEUP & 0xff };
+  if (bus.write(SHTC1_I2C_ADDRESS, wakeup, sizeof(wakeup))) {
+    waitMicroseconds(SHTC3_WAKEUP_DURATION);
+  }
+
+  const uint8_t cmd[] = { 0xEF, 0xC8 };
+  uint8_t data[3];
+  if (!readWords(bus, SHTC1_I2C_ADDRESS, cmd, sizeof(cmd),
+                 data, sizeof(data), 0)) {
+    return false;
+  }
+  id = (data[0] << 8) | data[1];
+  return true;
+}
+
+bool SHTC1Sensor::detect(SHTI2cBus &bus)
+{
+  // the lower 6 bits of the ID identify the SHTC1 family
+  uint16_t id;
+  return readId(bus, id) && (id & 0x3f) == 0x07;
 }
 
 
 //
-// class SHTSensor
+// class SHTC3Sensor
 //
 
-const SHTSensor::SHTSensorType SHTSensor::AUTO_DETECT_SENSORS[] = {
-  SHT3X,
-  SHT3X_ALT,
-  SHTC1,
-  SHT4X
-};
-const float SHTSensor::TEMPERATURE_INVALID = NAN;
-const float SHTSensor::HUMIDITY_INVALID = NAN;
+bool SHTC3Sensor::detect(SHTI2cBus &bus)
+{
+  // bit 11 of the ID is set for the SHTC3 only
+  uint16_t id;
+  return readId(bus, id) && (id & 0x3f) == 0x07 && (id & 0x0800);
+}
 
-bool SHTSensor::init()
+void SHTC3Sensor::wakeUp()
 {
-  if (mSensor != NULL) {
-    cleanup();
+  // fails if the sensor is awake already, which is fine
+  if (sendCommand(SHTC3_WAKEUP)) {
+    waitMicroseconds(SHTC3_WAKEUP_DURATION);
   }
+}
 
-  switch(mSensorType) {
-    case SHT3X:
-      mSensor = new SHT3xSensor();
-      break;
-
-    case SHT3X_ALT:
-      mSensor = new SHT3xSensor(SHT3xSensor::SHT3X_I2C_ADDRESS_45);
-      break;
+void SHTC3Sensor::sleep()
+{
+  sendCommand(SHTC3_SLEEP);
+}
 
-    case SHTW1:
-    case SHTW2:
-    case SHTC1:
-    case SHTC3:
-      mSensor = new SHTC1Sensor();
-      break;
-    case SHT4X:
-      mSensor = new SHT4xSensor();
+bool SHTC3Sensor::setAccuracy(SHTSensor::SHTAccuracy newAccuracy)
+{
+  switch (newAccuracy) {
+    case SHTSensor::SHT_ACCURACY_HIGH:
+      mI2cCommand = mClockStretching ? SHTC3_MEASURE_NORMAL_CLOCK_STRETCHING
+                                     : SHTC3_MEASURE_NORMAL;
+      mHumidityFirstCommand = mClockStretching ?
+          SHTC3_MEASURE_NORMAL_HUMIDITY_FIRST_CLOCK_STRETCHING :
+          SHTC3_MEASURE_NORMAL_HUMIDITY_FIRST;
+      mDuration = SHTC3_NORMAL_DURATION;
+      mTypicalDuration = SHTC3_NORMAL_TYPICAL_DURATION;
       break;
-    case AUTO_DETECT:
-    {
-      bool detected = false;
-      for (unsigned int i = 0;
-           i < sizeof(AUTO_DETECT_SENSORS) / sizeof(AUTO_DETECT_SENSORS[0]);
-           ++i) {
-        mSensorType = AUTO_DETECT_SENSORS[i];
-        delay(40); // TODO: this was necessary to make SHT4x autodetect work; revisit to find root cause
-        if (init()) {
-          detected = true;
-          break;
-        }
-      }
-      if (!detected) {
-        cleanup();
-      }
+    case SHTSensor::SHT_ACCURACY_LOW:
+      mI2cCommand = mClockStretching ? SHTC3_MEASURE_LOW_POWER_CLOCK_STRETCHING
+                                     : SHTC3_MEASURE_LOW_POWER;
+      mHumidityFirstCommand = mClockStretching ?
+          SHTC3_MEASURE_LOW_POWER_HUMIDITY_FIRST_CLOCK_STRETCHING :
+          SHTC3_MEASURE_LOW_POWER_HUMIDITY_FIRST;
+      mDuration = SHTC3_LOW_POWER_DURATION;
+      mTypicalDuration = SHTC3_LOW_POWER_TYPICAL_DURATION;
       break;
-    }
+    default:
+      return false;
+  }
+  mAccuracy = newAccuracy;
+  mLearnedDuration = 0;
+  return true;
+}
+
+bool SHTC3Sensor::setClockStretching(bool enable)
+{
+  mClockStretching = enable;
+  return setAccuracy(mAccuracy);
+}
+
+bool SHTC3Sensor::measure(uint16_t command, ResultLayout layout)
+{
+  wakeUp();
+  bool success = SHTC1Sensor::measure(command, layout);
+  sleep();
+  return success;
+}
+
+bool SHTC3Sensor::startMeasurement()
+{
+  wakeUp();
+  if (!SHTC1Sensor::startMeasurement()) {
+    // no result will be fetched, which would send the sensor back to sleep
+    sleep();
+    return false;
+  }
+  return true;
+}
+
+bool SHTC3Sensor::fetchSample()
+{
+  if (!isSampleReady()) {
+    // measuring, the sensor can't go to sleep yet
+    return false;
+  }
+  bool success = SHTC1Sensor::fetchSample();
+  sleep();
+  return success;
+}
+
+bool SHTC3Sensor::completeFetch(const SHTI2cBus::ReadTransfer &transfer)
+{
+  bool success = SHTC1Sensor::completeFetch(transfer);
+  sleep();
+  return success;
+}
+
+float SHTC3Sensor::getEnergyPerSample(float supplyVoltage) const
+{
+  // measuring for the typical conversion time, idle while waking up;
+  // uA * us = pC, so V * uA * us * 1e-6 = uJ
+  return supplyVoltage * 1e-6f *
+      ((float)SHTC3_MEASUREMENT_CURRENT * mTypicalDuration +
+       (float)SHTC3_IDLE_CURRENT * SHTC3_WAKEUP_DURATION);
+}
+
+
+//
+// class SHT3xSensor
+//
+
+const uint16_t SHT3xSensor::SHT3X_PERIODIC_COMMANDS[][3] = {
+  // high,  medium, low
+  { 0x2032, 0x2024, 0x202F }, // 0.5 mps
+  { 0x2130, 0x2126, 0x212D }, // 1 mps
+  { 0x2236, 0x2220, 0x222B }, // 2 mps
+  { 0x2334, 0x2322, 0x2329 }, // 4 mps
+  { 0x2737, 0x2721, 0x272A }  // 10 mps
+};
+
+bool SHT3xSensor::sendBreak()
+{
+  if (!sendCommand(SHT3X_BREAK)) {
+    return false;
+  }
+  SHTClock::getCurrent().delay(SHT3X_BREAK_DURATION);
+  return true;
+}
+
+void SHT3xSensor::stopStalePeriodicMode()
+{
+  if (mPeriodic || mModeKnown) {
+    return;
+  }
+  // the sensor keeps measuring periodically across a reset of the host
+  mModeKnown = sendBreak();
+}
+
+bool SHT3xSensor::detect(SHTI2cBus &bus, uint8_t i2cAddress)
+{
+  // a sensor left in the periodic mode rejects the status read below; the
+  // SHT4x sharing the addresses does not acknowledge the break
+  const uint8_t stop[] = { SHT3X_BREAK >> 8, SHT3X_BREAK & 0xff };
+  if (bus.write(i2cAddress, stop, sizeof(stop))) {
+    SHTClock::getCurrent().delay(SHT3X_BREAK_DURATION);
   }
 
+  // read status register, which the SHT4x sharing the addresses doesn't have
+  const uint8_t cmd[] = { 0xF3, 0x2D };
+  uint8_t data[3];
+  return readWords(bus, i2cAddress, cmd, sizeof(cmd), data, sizeof(data), 0);
+}
+
+bool SHT3xSensor::measure(uint16_t command, ResultLayout layout)
+{
+  stopStalePeriodicMode();
+  return SHTI2cSensor::measure(command, layout);
+}
+
+bool SHT3xSensor::startMeasurement()
+{
+  stopStalePeriodicMode();
+  return SHTI2cSensor::startMeasurement();
+}
+
+bool SHT3xSensor::setAccuracy(SHTSensor::SHTAccuracy newAccuracy)
+{
+  uint16_t command;
+  uint16_t duration;
+  uint16_t typicalDuration;
+  switch (newAccuracy) {
+    case SHTSensor::SHT_ACCURACY_HIGH:
+      command = mClockStretching ? SHT3X_ACCURACY_HIGH_CLOCK_STRETCHING
+                                 : SHT3X_ACCURACY_HIGH;
+      duration = SHT3X_ACCURACY_HIGH_DURATION;
+      typicalDuration = SHT3X_ACCURACY_HIGH_TYPICAL_DURATION;
+      break;
+    case SHTSensor::SHT_ACCURACY_MEDIUM:
+      command = mClockStretching ? SHT3X_ACCURACY_MEDIUM_CLOCK_STRETCHING
+                                 : SHT3X_ACCURACY_MEDIUM;
+      duration = SHT3X_ACCURACY_MEDIUM_DURATION;
+      typicalDuration = SHT3X_ACCURACY_MEDIUM_TYPICAL_DURATION;
+      break;
+    case SHTSensor::SHT_ACCURACY_LOW:
+      command = mClockStretching ? SHT3X_ACCURACY_LOW_CLOCK_STRETCHING
+                                 : SHT3X_ACCURACY_LOW;
+      duration = SHT3X_ACCURACY_LOW_DURATION;
+      typicalDuration = SHT3X_ACCURACY_LOW_TYPICAL_DURATION;
+      break;
+    default:
+      return false;
+  }
+  mAccuracy = newAccuracy;
+  if (mPeriodic) {
+    // the repeatability of the periodic mode is part of its start command
+    return startPeriodicMeasurement(mPeriodicRate);
+  }
+  mI2cCommand = command;
+  mDuration = duration;
+  mTypicalDuration = typicalDuration;
+  mLearnedDuration = 0;
+  return true;
+}
+
+bool SHT3xSensor::setClockStretching(bool enable)
+{
+  mClockStretching = enable;
+  // a running periodic mode picks the command up when it is stopped
+  return mPeriodic || setAccuracy(mAccuracy);
+}
+
+bool SHT3xSensor::startPeriodicMeasurement(SHTSensor::SHTPeriodicRate rate)
+{
+  if (rate > SHTSensor::SHT_PERIODIC_10_MPS) {
+    return false;
+  }
+  // a running periodic mode must be stopped before it can be reconfigured
+  if (mPeriodic && !stopPeriodicMeasurement()) {
+    return false;
+  }
+  stopStalePeriodicMode();
+  if (!sendCommand(SHT3X_PERIODIC_COMMANDS[rate][mAccuracy])) {
+    return false;
+  }
+  mPeriodicRate = rate;
+  mPeriodic = true;
+  // results are fetched from the sensor's buffer without conversion time
+  mI2cCommand = SHT3X_FETCH_DATA;
+  mDuration = 0;
+  return true;
+}
+
+bool SHT3xSensor::stopPeriodicMeasurement()
+{
+  if (!mPeriodic || !sendBreak()) {
+    return false;
+  }
+  mPeriodic = false;
+  return setAccuracy(mAccuracy);
+}
+
+
+//
+// class SHT4xSensor
+//
+
+bool SHT4xSensor::detect(SHTI2cBus &bus, uint8_t i2cAddress)
+{
+  // read serial number, a single byte command the SHT3x doesn't accept
+  const uint8_t cmd[] = { 0x89 };
+  uint8_t data[6];
+  return readWords(bus, i2cAddress, cmd, sizeof(cmd), data, sizeof(data), 1000);
+}
+
+bool SHT4xSensor::setAccuracy(SHTSensor::SHTAccuracy newAccuracy)
+{
+  switch (newAccuracy) {
+    case SHTSensor::SHT_ACCURACY_HIGH:
+      mI2cCommand = SHT4X_ACCURACY_HIGH;
+      mDuration = SHT4X_ACCURACY_HIGH_DURATION;
+      mTypicalDuration = SHT4X_ACCURACY_HIGH_TYPICAL_DURATION;
+      break;
+    case SHTSensor::SHT_ACCURACY_MEDIUM:
+      mI2cCommand = SHT4X_ACCURACY_MEDIUM;
+      mDuration = SHT4X_ACCURACY_MEDIUM_DURATION;
+      mTypicalDuration = SHT4X_ACCURACY_MEDIUM_TYPICAL_DURATION;
+      break;
+    case SHTSensor::SHT_ACCURACY_LOW:
+      mI2cCommand = SHT4X_ACCURACY_LOW;
+      mDuration = SHT4X_ACCURACY_LOW_DURATION;
+      mTypicalDuration = SHT4X_ACCURACY_LOW_TYPICAL_DURATION;
+      break;
+    default:
+      return false;
+  }
+  mLearnedDuration = 0;
+  return true;
+}
+
+
+#ifdef ARDUINO
+
+//
+// class SHT3xAnalogSensor
+//
+
+float SHT3xAnalogSensor::readHumidity()
+{
+  float max_adc = (float)((1 << mReadResolutionBits) - 1);
+  return -12.5f + 125 * (analogRead(mHumidityAdcPin) / max_adc);
+}
+
+float SHT3xAnalogSensor::readTemperature()
+{
+  float max_adc = (float)((1 << mReadResolutionBits) - 1);
+  return -66.875f + 218.75f * (analogRead(mTemperatureAdcPin) / max_adc);
+}
+
+#endif /* ARDUINO */
+
+
+//
+// class SHTSensor
+//
+
+const SHTSensor::SHTSensorType SHTSensor::AUTO_DETECT_SENSORS[] = {
+  SHT3X,
+  SHT3X_ALT,
+  SHTC3,
+  SHTC1,
+  SHT4X
+};
+const float SHTSensorBase::TEMPERATURE_INVALID = NAN;
+const float SHTSensorBase::HUMIDITY_INVALID = NAN;
+
+bool SHTSensor::init()
+{
+  if (mSensor != NULL) {
+    cleanup();
+  }
+
+  if (mBus == NULL) {
+    return false;
+  }
+
+  switch(mSensorType) {
+    case SHT3X:
+      mSensor = new (&mDriver.sht3x) SHT3xSensor(*mBus,
+          mI2cAddress ? mI2cAddress : SHT3xSensor::SHT3X_I2C_ADDRESS_44);
+      break;
+
+    case SHT3X_ALT:
+      mSensor = new (&mDriver.sht3x) SHT3xSensor(*mBus,
+          mI2cAddress ? mI2cAddress : SHT3xSensor::SHT3X_I2C_ADDRESS_45);
+      break;
+
+    case SHTW1:
+    case SHTW2:
+    case SHTC1:
+      mSensor = new (&mDriver.shtc1) SHTC1Sensor(*mBus);
+      break;
+    case SHTC3:
+      mSensor = new (&mDriver.shtc3) SHTC3Sensor(*mBus);
+      break;
+    case SHT4X:
+      mSensor = new (&mDriver.sht4x) SHT4xSensor(*mBus,
+          mI2cAddress ? mI2cAddress : SHT4xSensor::SHT4X_I2C_ADDRESS_44);
+      break;
+    case AUTO_DETECT:
+    {
+      // only addresses acknowledging a probe are queried for their ID, which
+      // also tells the SHT3x and SHT4x sharing 0x44 apart
+      for (unsigned int i = 0;
+           i < sizeof(AUTO_DETECT_SENSORS) / sizeof(AUTO_DETECT_SENSORS[0]);
+           ++i) {
+        if (detect(*mBus, AUTO_DETECT_SENSORS[i])) {
+          mSensorType = AUTO_DETECT_SENSORS[i];
+          return init();
+        }
+      }
+      break;
+    }
+  }
+
+#if SHT_STATISTICS
+  if (mSensor) {
+    mSensor->mStatistics = &mStatistics;
+  }
+#endif
+
   // to finish the initialization, attempt to read to make sure the communication works
   // Note: readSample() will check for a NULL mSensor in case auto detect failed
   return readSample();
 }
 
+bool SHTSensor::detect(SHTI2cBus &bus, SHTSensorType sensorType)
+{
+  switch (sensorType) {
+    case SHT3X:
+      return bus.probe(SHT3xSensor::SHT3X_I2C_ADDRESS_44) &&
+          SHT3xSensor::detect(bus, SHT3xSensor::SHT3X_I2C_ADDRESS_44);
+    case SHT3X_ALT:
+      return bus.probe(SHT3xSensor::SHT3X_I2C_ADDRESS_45) &&
+          SHT3xSensor::detect(bus, SHT3xSensor::SHT3X_I2C_ADDRESS_45);
+    case SHTW1:
+    case SHTW2:
+    case SHTC1:
+      return bus.probe(SHTC1Sensor::SHTC1_I2C_ADDRESS) &&
+          SHTC1Sensor::detect(bus);
+    case SHTC3:
+      return bus.probe(SHTC1Sensor::SHTC1_I2C_ADDRESS) &&
+          SHTC3Sensor::detect(bus);
+    case SHT4X:
+      return bus.probe(SHT4xSensor::SHT4X_I2C_ADDRESS_44) &&
+          SHT4xSensor::detect(bus, SHT4xSensor::SHT4X_I2C_ADDRESS_44);
+    default:
+      return false;
+  }
+}
+
+SHTSensor::SHTScanResult SHTSensor::scanBus()
+{
+  SHTI2cBus *bus = SHTI2cBus::getDefault();
+  if (bus == NULL) {
+    SHTScanResult result;
+    result.count = 0;
+    return result;
+  }
+  return scanBus(*bus);
+}
+
+SHTSensor::SHTScanResult SHTSensor::scanBus(SHTI2cBus &bus)
+{
+  static const uint8_t SHT_I2C_ADDRESSES[] = {
+    SHT3xSensor::SHT3X_I2C_ADDRESS_44,
+    SHT3xSensor::SHT3X_I2C_ADDRESS_45
+  };
+  SHTScanResult result;
+  result.count = 0;
+
+  // the SHT3x and SHT4x share their addresses and are told apart by their ID
+  for (uint8_t i = 0; i < sizeof(SHT_I2C_ADDRESSES); ++i) {
+    uint8_t address = SHT_I2C_ADDRESSES[i];
+    if (!bus.probe(address)) {
+      continue;
+    }
+    SHTSensorInfo &info = result.sensors[result.count];
+    info.i2cAddress = address;
+    if (SHT3xSensor::detect(bus, address)) {
+      info.sensorType =
+          (address == SHT3xSensor::SHT3X_I2C_ADDRESS_44) ? SHT3X : SHT3X_ALT;
+      ++result.count;
+    } else if (SHT4xSensor::detect(bus, address)) {
+      info.sensorType = SHT4X;
+      ++result.count;
+    }
+  }
+
+  if (bus.probe(SHTC1Sensor::SHTC1_I2C_ADDRESS) &&
+      SHTC1Sensor::detect(bus)) {
+    SHTSensorInfo &info = result.sensors[result.count++];
+    info.sensorType = SHTC3Sensor::detect(bus) ? SHTC3 : SHTC1;
+    info.i2cAddress = SHTC1Sensor::SHTC1_I2C_ADDRESS;
+  }
+
+  return result;
+}
+
 bool SHTSensor::readSample()
 {
-  if (!mSensor || !mSensor->readSample())
+  return readValues(true, true);
+}
+
+bool SHTSensor::readTemperatureOnly()
+{
+  return readValues(true, false);
+}
+
+bool SHTSensor::readHumidityOnly()
+{
+  return readValues(false, true);
+}
+
+bool SHTSensor::readValues(bool temperature, bool humidity)
+{
+#if SHT_STATISTICS
+  unsigned long start = SHTClock::getCurrent().micros();
+#endif
+  bool success = false;
+  if (mSensor) {
+    if (temperature && humidity)
+      success = mSensor->readSample();
+    else if (temperature)
+      success = mSensor->readTemperatureOnly();
+    else
+      success = mSensor->readHumidityOnly();
+  }
+  if (success)
+    copySample(temperature, humidity);
+#if SHT_STATISTICS
+  countRead(success);
+  countLatency(SHTClock::getCurrent().micros() - start);
+#endif
+  return success;
+}
+
+float SHTSensor::getHumidity() const
+{
+  if (!mSensor || !mHasHumidity)
+    return HUMIDITY_INVALID;
+  return mSensor->convertHumidity(mRawHumidity);
+}
+
+float SHTSensor::getTemperature() const
+{
+  if (!mSensor || !mHasTemperature)
+    return TEMPERATURE_INVALID;
+  return mSensor->convertTemperature(mRawTemperature);
+}
+
+float SHTSensor::convertHumidity(uint16_t rawHumidity) const
+{
+  if (!mSensor)
+    return HUMIDITY_INVALID;
+  return mSensor->convertHumidity(rawHumidity);
+}
+
+float SHTSensor::convertTemperature(uint16_t rawTemperature) const
+{
+  if (!mSensor)
+    return TEMPERATURE_INVALID;
+  return mSensor->convertTemperature(rawTemperature);
+}
+
+bool SHTSensor::convertSamples(const SHTRawSample *samples, uint16_t count,
+                               float *temperatures, float *humidities) const
+{
+  if (!mSensor)
     return false;
-  mTemperature = mSensor->mTemperature;
-  mHumidity = mSensor->mHumidity;
+  mSensor->convertSamples(samples, count, temperatures, humidities);
   return true;
 }
 
+int32_t SHTSensor::getHumidityCentiPercent() const
+{
+  if (!mSensor || !mHasHumidity)
+    return FIXED_POINT_INVALID;
+  return mSensor->convertHumidityCentiPercent(mRawHumidity);
+}
+
+int32_t SHTSensor::getTemperatureCentiCelsius() const
+{
+  if (!mSensor || !mHasTemperature)
+    return FIXED_POINT_INVALID;
+  return mSensor->convertTemperatureCentiCelsius(mRawTemperature);
+}
+
+bool SHTSensor::startMeasurement()
+{
+  if (!mSensor)
+    return false;
+  return mSensor->startMeasurement();
+}
+
+bool SHTSensor::isSampleReady() const
+{
+  if (!mSensor)
+    return false;
+  return mSensor->isSampleReady();
+}
+
+bool SHTSensor::fetchSample()
+{
+  if (mSensor && !mSensor->isSampleReady()) {
+    // nothing to fetch yet: polling, not a failed read
+    return false;
+  }
+  bool success = mSensor && mSensor->fetchSample();
+  if (success)
+    copySample();
+#if SHT_STATISTICS
+  countRead(success);
+#endif
+  return success;
+}
+
 bool SHTSensor::setAccuracy(SHTAccuracy newAccuracy)
 {
   if (!mSensor)
@@ -347,10 +1200,264 @@ bool SHTSensor::setAccuracy(SHTAccuracy newAccuracy)
   return mSensor->setAccuracy(newAccuracy);
 }
 
+bool SHTSensor::setReadyPolling(bool enable, uint16_t pollInterval,
+                                uint8_t timeout)
+{
+  if (!mSensor)
+    return false;
+  return mSensor->setReadyPolling(enable, pollInterval, timeout);
+}
+
+bool SHTSensor::setClockStretching(bool enable)
+{
+  if (!mSensor)
+    return false;
+  return mSensor->setClockStretching(enable);
+}
+
+bool SHTSensor::setDurationLearning(bool enable, uint16_t margin)
+{
+  if (!mSensor)
+    return false;
+  return mSensor->setDurationLearning(enable, margin);
+}
+
+uint16_t SHTSensor::getLearnedDuration() const
+{
+  if (!mSensor)
+    return 0;
+  return mSensor->getLearnedDuration();
+}
+
+bool SHTSensor::startPeriodicMeasurement(SHTPeriodicRate rate)
+{
+  if (!mSensor)
+    return false;
+  return mSensor->startPeriodicMeasurement(rate);
+}
+
+bool SHTSensor::stopPeriodicMeasurement()
+{
+  if (!mSensor)
+    return false;
+  return mSensor->stopPeriodicMeasurement();
+}
+
+uint8_t SHTSensor::getMeasurementDuration() const
+{
+  if (!mSensor)
+    return 0;
+  return mSensor->getMeasurementDuration();
+}
+
+uint16_t SHTSensor::getMeasurementDurationMicros() const
+{
+  if (!mSensor)
+    return 0;
+  return mSensor->getMeasurementDurationMicros();
+}
+
+float SHTSensor::getEnergyPerSample(float supplyVoltage) const
+{
+  if (!mSensor)
+    return 0;
+  return mSensor->getEnergyPerSample(supplyVoltage);
+}
+
+SHTI2cBus *SHTSensor::prepareFetch(SHTI2cBus::ReadTransfer &transfer)
+{
+  if (!mSensor)
+    return NULL;
+  return mSensor->prepareFetch(transfer);
+}
+
+bool SHTSensor::completeFetch(const SHTI2cBus::ReadTransfer &transfer)
+{
+#if SHT_STATISTICS
+  // a result not acknowledged before the conversion time has passed is
+  // not ready yet rather than a failed read
+  bool due = !mSensor || mSensor->isSampleReady();
+#endif
+  bool success = mSensor && mSensor->completeFetch(transfer);
+  if (success)
+    copySample();
+#if SHT_STATISTICS
+  if (success || due)
+    countRead(success);
+#endif
+  return success;
+}
+
+void SHTSensor::copySample(bool temperature, bool humidity)
+{
+  if (temperature) {
+    mRawTemperature = mSensor->mRawTemperature;
+    mHasTemperature = true;
+  }
+  if (humidity) {
+    mRawHumidity = mSensor->mRawHumidity;
+    mHasHumidity = true;
+  }
+
+  // a partial read would pass the other value as if it was new
+  if (mSampleSinks && temperature && humidity) {
+    SHTRawSample sample = getRawSample();
+    for (SHTSampleSink *sink = mSampleSinks; sink; sink = sink->mNextSink) {
+      sink->addSample(*this, sample);
+    }
+  }
+}
+
+bool SHTSensor::addSampleSink(SHTSampleSink &sink)
+{
+  if (sink.mOwner) {
+    // attached to this or another sensor
+    return false;
+  }
+  SHTSampleSink **last = &mSampleSinks;
+  while (*last) {
+    last = &(*last)->mNextSink;
+  }
+  *last = &sink;
+  sink.mOwner = this;
+  return true;
+}
+
+bool SHTSensor::removeSampleSink(SHTSampleSink &sink)
+{
+  if (sink.mOwner != this) {
+    return false;
+  }
+  for (SHTSampleSink **link = &mSampleSinks; *link; link = &(*link)->mNextSink) {
+    if (*link == &sink) {
+      *link = sink.mNextSink;
+      break;
+    }
+  }
+  sink.mOwner = NULL;
+  sink.mNextSink = NULL;
+  return true;
+}
+
+void SHTSensor::releaseSampleSinks()
+{
+  while (mSampleSinks) {
+    SHTSampleSink *sink = mSampleSinks;
+    mSampleSinks = sink->mNextSink;
+    sink->mOwner = NULL;
+    sink->mNextSink = NULL;
+  }
+}
+
+#if SHT_STATISTICS
+void SHTSensor::resetStatistics()
+{
+  memset(&mStatistics, 0, sizeof(mStatistics));
+}
+
+void SHTSensor::countRead(bool success)
+{
+  ++mStatistics.attempts;
+  if (success) {
+    ++mStatistics.successes;
+  } else if (!mSensor) {
+    ++mStatistics.noDriver;
+  }
+}
+
+void SHTSensor::countLatency(unsigned long latency)
+{
+  uint8_t bucket = 0;
+  while (bucket < SHTStatistics::LATENCY_BUCKETS - 1 &&
+         latency >= (1024UL << bucket)) {
+    ++bucket;
+  }
+  ++mStatistics.latency[bucket];
+}
+#endif /* SHT_STATISTICS */
+
 void SHTSensor::cleanup()
 {
   if (mSensor) {
-    delete mSensor;
+    mSensor->~SHTSensorDriver();
     mSensor = NULL;
   }
 }
+
+
+//
+// class SHTSensorGroup
+//
+
+bool SHTSensorGroup::readSample()
+{
+  uint32_t started = 0;
+  uint16_t duration = 0;
+
+  // trigger all sensors back to back...
+  for (uint8_t i = 0; i < mCount; ++i) {
+    if (mSensors[i]->startMeasurement()) {
+      started |= (uint32_t)1 << i;
+      uint16_t sensorDuration = mSensors[i]->getMeasurementDurationMicros();
+      if (sensorDuration > duration) {
+        duration = sensorDuration;
+      }
+    }
+  }
+
+  // ...wait once for the slowest one...
+  if (started && duration > 0) {
+    waitMicroseconds(duration);
+  }
+
+  // ...and collect all results, batching the reads of sensors sharing a bus
+  mValidSamples = 0;
+  uint32_t pending = started;
+  while (pending) {
+    SHTI2cBus::ReadTransfer transfers[BATCH_SIZE];
+    uint8_t buffers[BATCH_SIZE][SHTI2cSensor::EXPECTED_DATA_SIZE];
+    uint8_t members[BATCH_SIZE];
+    SHTI2cBus *batchBus = NULL;
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < mCount && count < BATCH_SIZE; ++i) {
+      uint32_t mask = (uint32_t)1 << i;
+      if (!(pending & mask)) {
+        continue;
+      }
+      SHTI2cBus::ReadTransfer &transfer = transfers[count];
+      transfer.data = buffers[count];
+      transfer.success = false;
+      SHTI2cBus *bus = mSensors[i]->prepareFetch(transfer);
+      if (!bus) {
+        // not an i2c sensor or nothing to fetch: use the regular path
+        pending &= ~mask;
+        if (mSensors[i]->fetchSample()) {
+          mValidSamples |= mask;
+        }
+        continue;
+      }
+      if (!batchBus) {
+        batchBus = bus;
+      } else if (bus != batchBus) {
+        continue; // collected with the next batch
+      }
+      pending &= ~mask;
+      members[count++] = i;
+    }
+
+    if (count == 0) {
+      break;
+    }
+    batchBus->readBatch(transfers, count);
+    for (uint8_t j = 0; j < count; ++j) {
+      if (mSensors[members[j]]->completeFetch(transfers[j])) {
+        mValidSamples |= (uint32_t)1 << members[j];
+      }
+    }
+  }
+
+  uint32_t all = (mCount < MAX_SENSORS) ? ((uint32_t)1 << mCount) - 1
+                                        : (uint32_t)-1;
+  return mValidSamples == all;
+}
@@ -30,14 +30,63 @@
 #define SHTSENSOR_H
 
 #include <inttypes.h>
+#include <stddef.h>
 
-// Forward declaration
-class SHTSensorDriver;
+#ifdef ARDUINO
+#include <Wire.h>
+#endif
 
 /**
- * Official interface for Sensirion SHT Sensors
+ * Implementations of the CRC8 check of the sensor data, see SHT_CRC8_IMPL
+ */
+/** Bit by bit calculation, smallest flash footprint (default) */
+#define SHT_CRC8_BITWISE      0
+/** 16 entry lookup table, processes a nibble at a time */
+#define SHT_CRC8_NIBBLE_TABLE 1
+/** 256 entry lookup table, processes a byte at a time */
+#define SHT_CRC8_BYTE_TABLE   2
+
+/**
+ * The CRC8 implementation is selected at compile time by defining
+ * SHT_CRC8_IMPL to one of the values above, e.g. with the compiler flag
+ * -DSHT_CRC8_IMPL=SHT_CRC8_BYTE_TABLE. The lookup tables are stored in flash
+ * (PROGMEM) and trade flash size for speed; all implementations compute the
+ * same result.
+ */
+#ifndef SHT_CRC8_IMPL
+#define SHT_CRC8_IMPL SHT_CRC8_BITWISE
+#endif
+
+/**
+ * Define SHT_STATISTICS to 1, e.g. with the compiler flag -DSHT_STATISTICS=1,
+ * to count the outcome and latency of the reads of every SHTSensor, see
+ * SHTSensor::getStatistics(). Disabled by default, the counters then take no
+ * memory and no time.
  */
-class SHTSensor
+#ifndef SHT_STATISTICS
+#define SHT_STATISTICS 0
+#endif
+
+/**
+ * Define SHT_GROUP_BATCH_SIZE to the maximum number of results a
+ * SHTSensorGroup reads from one bus with a single SHTI2cBus::readBatch()
+ * call. Each result takes about 12 bytes of stack in
+ * SHTSensorGroup::readSample(), so the default is 8 on Arduino; on other
+ * platforms it is 32, every sensor of a group.
+ */
+#ifndef SHT_GROUP_BATCH_SIZE
+#ifdef ARDUINO
+#define SHT_GROUP_BATCH_SIZE 8
+#else
+#define SHT_GROUP_BATCH_SIZE 32
+#endif
+#endif
+
+/**
+ * Sensor types, settings and constants shared by SHTSensor and its drivers.
+ * Use them through SHTSensor, e.g. SHTSensorBase::SHT_ACCURACY_HIGH
+ */
+class SHTSensorBase
 {
 public:
   /**
@@ -74,115 +123,441 @@ public:
     SHT_ACCURACY_LOW
   };
 
+  /**
+   * Measurement rate of the periodic acquisition mode, in measurements per
+   * second (mps).
+   * Not all sensors support periodic measurements.
+   */
+  enum SHTPeriodicRate {
+    /** One measurement every two seconds */
+    SHT_PERIODIC_0_5_MPS,
+    /** One measurement per second */
+    SHT_PERIODIC_1_MPS,
+    /** Two measurements per second */
+    SHT_PERIODIC_2_MPS,
+    /** Four measurements per second */
+    SHT_PERIODIC_4_MPS,
+    /** Ten measurements per second */
+    SHT_PERIODIC_10_MPS
+  };
+
   /** Value reported by getHumidity() when the sensor is not initialized */
   static const float HUMIDITY_INVALID;
   /** Value reported by getTemperature() when the sensor is not initialized */
   static const float TEMPERATURE_INVALID;
   /**
-   * Auto-detectable sensor types.
-   * Note that the SHTC3, SHTW1 and SHTW2 share exactly the same driver as the SHTC1
-   * and are thus not listed individually.
+   * Value reported by getHumidityCentiPercent() and
+   * getTemperatureCentiCelsius() when no sample was read
    */
-  static const SHTSensorType AUTO_DETECT_SENSORS[];
+  static const int32_t FIXED_POINT_INVALID = INT32_MIN;
 
   /**
-   * Instantiate a new SHTSensor
-   * By default, the i2c bus is queried for known SHT Sensors. To address
-   * a specific sensor, set the `sensorType'.
+   * Raw sensor values of one sample in 4 bytes, see SHTSensor::getRawSample()
+   * Convert them with the SHTSensor they were read from.
    */
-  SHTSensor(SHTSensorType sensorType = AUTO_DETECT)
-      : mSensorType(sensorType),
-        mSensor(NULL),
-        mTemperature(SHTSensor::TEMPERATURE_INVALID),
-        mHumidity(SHTSensor::HUMIDITY_INVALID)
+  struct SHTRawSample {
+    uint16_t temperature;
+    uint16_t humidity;
+  };
+
+#if SHT_STATISTICS
+  /** Counters of the reads of a sensor, see SHTSensor::getStatistics() */
+  struct SHTStatistics {
+    /** Number of latency histogram buckets */
+    static const uint8_t LATENCY_BUCKETS = 8;
+
+    /**
+     * Reads attempted with readSample(), or with fetchSample() once the
+     * conversion time has passed
+     */
+    uint32_t attempts;
+    /** Reads returning a valid sample */
+    uint32_t successes;
+    /** Commands not acknowledged by the sensor */
+    uint32_t writeNacks;
+    /** Results not acknowledged or incomplete, including combined transfers */
+    uint32_t shortReads;
+    /** CRC mismatches, indexed by the position of the word in the result */
+    uint32_t crcFailures[2];
+    /** Reads attempted without a driver, i.e. before a successful init() */
+    uint32_t noDriver;
+    /**
+     * Latency of readSample() including the measurement: bucket n counts
+     * reads taking less than 1024 << n microseconds, the last bucket all
+     * longer ones
+     */
+    uint32_t latency[LATENCY_BUCKETS];
+  };
+#endif /* SHT_STATISTICS */
+};
+
+
+/**
+ * Time source used by the library to timestamp and wait for measurements
+ *
+ * By default, the Arduino timing functions are used, or the monotonic clock
+ * on other platforms. Install another clock with setCurrent(), e.g. a virtual
+ * clock letting host simulations run faster than real time.
+ */
+class SHTClock
+{
+public:
+  virtual ~SHTClock()
   {
   }
 
-  virtual ~SHTSensor() {
-    cleanup();
+  // no heap allocation: only the placement form of operator new is available
+  static void *operator new(size_t, void *where) {
+    return where;
+  }
+  static void operator delete(void *, void *) {
+  }
+  // only referenced by the deleting destructor, never called
+  static void operator delete(void *) {
   }
 
+  /** Returns the time in milliseconds, like the Arduino millis() */
+  virtual unsigned long millis() = 0;
+
+  /** Returns the time in microseconds, like the Arduino micros() */
+  virtual unsigned long micros() = 0;
+
+  /** Wait for `ms' milliseconds */
+  virtual void delay(unsigned long ms) = 0;
+
+  /** Wait for `us' microseconds */
+  virtual void delayMicroseconds(unsigned int us) = 0;
+
+  /** Get the clock used by the library */
+  static SHTClock &getCurrent();
+
   /**
-   * Initialize the sensor driver, and probe for the sensor on the bus
-   *
-   * If SHTSensor() was created with an empty constructor or with 'sensorType'
-   * AUTO_DETECT, init() will also try to automatically detect a sensor.
-   * Auto detection will stop as soon as the first sensor was found; if you have
-   * multiple sensor types on the bus, use the 'sensorType' argument of the
-   * constructor to control which sensor type will be instantiated.
-   *
-   * To read out the sensor use readSample(), followed by getTemperature() and
-   * getHumidity() to retrieve the values from the sample
-   *
-   * Returns true if communication with a sensor on the bus was successful, false otherwise
+   * Use `clock' from now on, or the default clock if NULL
+   * The clock must stay valid until it is replaced.
    */
-  bool init();
+  static void setCurrent(SHTClock *clock);
+};
+
+
+/**
+ * Abstract i2c bus used to communicate with the digital SHT Sensors
+ *
+ * By default, sensors use the Arduino `Wire' object through SHTWireBus.
+ * Implement this interface to use the sensors on other buses, e.g. a software
+ * i2c implementation or the i2c driver of an operating system.
+ */
+class SHTI2cBus
+{
+public:
+  virtual ~SHTI2cBus()
+  {
+  }
+
+  // no heap allocation: only the placement form of operator new is available
+  static void *operator new(size_t, void *where) {
+    return where;
+  }
+  static void operator delete(void *, void *) {
+  }
+  // only referenced by the deleting destructor, never called
+  static void operator delete(void *) {
+  }
 
   /**
-   * Read new values from the sensor
-   * After the call, use getTemperature() and getHumidity() to retrieve the
-   * values
-   * Returns true if the sample was read and the values are cached
+   * Write `length' bytes of `data' to the device at `i2cAddress'
+   * Returns true if the device acknowledged its address and all bytes
    */
-  bool readSample();
+  virtual bool write(uint8_t i2cAddress, const uint8_t *data,
+                     uint8_t length) = 0;
 
   /**
-   * Get the relative humidity in percent read from the last sample
-   * Use readSample() to trigger a new sensor reading
+   * Read `length' bytes from the device at `i2cAddress' into `data'
+   * Returns true if exactly `length' bytes were read
    */
-  float getHumidity() const {
-    return mHumidity;
+  virtual bool read(uint8_t i2cAddress, uint8_t *data, uint8_t length) = 0;
+
+  /**
+   * Write `commandLength' bytes of `command' to the device at `i2cAddress' and
+   * read `dataLength' bytes into `data' right after, without waiting in
+   * between. Buses supporting combined transfers override this to issue both
+   * in a single transaction.
+   * Returns true if the write and the read succeeded
+   */
+  virtual bool writeRead(uint8_t i2cAddress, const uint8_t *command,
+                         uint8_t commandLength, uint8_t *data,
+                         uint8_t dataLength) {
+    return write(i2cAddress, command, commandLength) &&
+        read(i2cAddress, data, dataLength);
   }
 
+  /** One read of a batch, see readBatch() */
+  struct ReadTransfer {
+    uint8_t i2cAddress;
+    uint8_t *data;
+    uint8_t length;
+    /** Set by readBatch(): true if exactly `length' bytes were read */
+    bool success;
+  };
+
   /**
-   * Get the temperature in Celsius read from the last sample
-   * Use readSample() to trigger a new sensor reading
+   * Perform the `count' reads of `transfers' and set their `success' flag.
+   * Buses supporting combined transfers override this to issue all reads in a
+   * single transaction.
+   * Returns the number of successful reads
    */
-  float getTemperature() const {
-    return mTemperature;
+  virtual uint8_t readBatch(ReadTransfer *transfers, uint8_t count) {
+    uint8_t successful = 0;
+    for (uint8_t i = 0; i < count; ++i) {
+      transfers[i].success = read(transfers[i].i2cAddress, transfers[i].data,
+                                  transfers[i].length);
+      if (transfers[i].success) {
+        ++successful;
+      }
+    }
+    return successful;
   }
 
   /**
-   * Change the sensor accurancy, if supported by the sensor
-   * Returns true if the accuracy was changed
+   * Returns true if a device acknowledges its `i2cAddress' on the bus. No data
+   * is transferred, so this is safe to use on any device.
    */
-  bool setAccuracy(SHTAccuracy newAccuracy);
+  virtual bool probe(uint8_t i2cAddress) {
+    return write(i2cAddress, NULL, 0);
+  }
 
-  SHTSensorType mSensorType;
+  /**
+   * Get the bus used by sensors for which no bus is given: SHTWireBus on the
+   * Arduino `Wire' object, or NULL if the platform has no default bus
+   */
+  static SHTI2cBus *getDefault();
+};
 
-private:
-  void cleanup();
+#ifdef ARDUINO
+/**
+ * SHTI2cBus on an Arduino TwoWire object, e.g. `Wire' or `Wire1'
+ * The TwoWire object must be initialized with begin() before it is used.
+ *
+ * Example usage:
+ * SHTWireBus bus1(Wire1);
+ * SHTSensor sht(bus1, SHTSensor::SHT4X);
+ */
+class SHTWireBus final : public SHTI2cBus
+{
+public:
+  SHTWireBus(TwoWire &wire)
+      : mWire(wire)
+  {
+  }
 
-  
-  SHTSensorDriver *mSensor;
-  float mTemperature;
-  float mHumidity;
+  virtual bool write(uint8_t i2cAddress, const uint8_t *data, uint8_t length);
+  virtual bool read(uint8_t i2cAddress, uint8_t *data, uint8_t length);
+
+  /** Get the bus on the Arduino `Wire' object, see SHTI2cBus::getDefault() */
+  static SHTWireBus *getDefault();
+
+private:
+  TwoWire &mWire;
 };
 
+/** Type of the default bus, see SHTI2cBus::getDefault() */
+typedef SHTWireBus SHTDefaultBus;
+#else
+typedef SHTI2cBus SHTDefaultBus;
+#endif /* ARDUINO */
 
-/** Abstract class for a digital SHT Sensor driver */
+/**
+ * Abstract class for a digital SHT Sensor driver
+ *
+ * Drivers are constructed in place inside SHTSensor and can't be allocated on
+ * the heap: only the placement form of operator new is available.
+ */
 class SHTSensorDriver
 {
 public:
+  SHTSensorDriver()
+      : mRawTemperature(0),
+        mRawHumidity(0)
+#if SHT_STATISTICS
+        , mStatistics(NULL)
+#endif
+  {
+  }
+
   virtual ~SHTSensorDriver() = 0;
 
+  static void *operator new(size_t, void *where) {
+    return where;
+  }
+  static void operator delete(void *, void *) {
+  }
+  // only referenced by the deleting destructor, never called
+  static void operator delete(void *) {
+  }
+
   /**
    * Set the sensor accuracy.
    * Returns false if the sensor does not support changing the accuracy
    */
-  virtual bool setAccuracy(SHTSensor::SHTAccuracy /* newAccuracy */) {
+  virtual bool setAccuracy(SHTSensorBase::SHTAccuracy /* newAccuracy */) {
+    return false;
+  }
+
+  /**
+   * Start the periodic acquisition mode.
+   * Returns false if the sensor does not support periodic measurements
+   */
+  virtual bool startPeriodicMeasurement(SHTSensorBase::SHTPeriodicRate /* rate */) {
+    return false;
+  }
+
+  /**
+   * Stop the periodic acquisition mode.
+   * Returns false if the sensor does not support periodic measurements
+   */
+  virtual bool stopPeriodicMeasurement() {
+    return false;
+  }
+
+  /**
+   * Configure polling for the result in readSample(), see
+   * SHTSensor::setReadyPolling().
+   * Returns false if the sensor does not support polling
+   */
+  virtual bool setReadyPolling(bool /* enable */, uint16_t /* pollInterval */,
+                               uint8_t /* timeout */) {
+    return false;
+  }
+
+  /**
+   * Use the clock stretching measurement commands, see
+   * SHTSensor::setClockStretching().
+   * Returns false if the sensor does not support clock stretching
+   */
+  virtual bool setClockStretching(bool /* enable */) {
+    return false;
+  }
+
+  /**
+   * Configure learning the conversion time, see
+   * SHTSensor::setDurationLearning().
+   * Returns false if the sensor does not support it
+   */
+  virtual bool setDurationLearning(bool /* enable */, uint16_t /* margin */) {
     return false;
   }
 
+  /** Returns the learned conversion time in microseconds, 0 if unknown */
+  virtual uint16_t getLearnedDuration() const {
+    return 0;
+  }
+
   /** Returns true if the next sample was read and the values are cached */
   virtual bool readSample();
 
+  /**
+   * Returns true if the temperature of the next sample was read and cached
+   * Only the first word of the result is read, the humidity is left as is.
+   */
+  virtual bool readTemperatureOnly() {
+    return false;
+  }
+
+  /**
+   * Returns true if the humidity of the next sample was read and cached
+   * Only supported by sensors that can measure the humidity first.
+   */
+  virtual bool readHumidityOnly() {
+    return false;
+  }
+
+  /**
+   * Trigger a new measurement without waiting for its completion.
+   * Returns false if the sensor does not support non-blocking measurements
+   */
+  virtual bool startMeasurement() {
+    return false;
+  }
+
+  /** Returns true if a started measurement can be fetched */
+  virtual bool isSampleReady() const {
+    return false;
+  }
+
+  /** Returns true if the started measurement was read and the values are cached */
+  virtual bool fetchSample() {
+    return false;
+  }
+
+  /**
+   * Prepare reading the started measurement as part of a batch: fill in the
+   * address and length of `transfer', whose data buffer must hold at least
+   * SHTI2cSensor::EXPECTED_DATA_SIZE bytes.
+   * Returns the bus to read from, or NULL if no measurement is pending
+   */
+  virtual SHTI2cBus *prepareFetch(SHTI2cBus::ReadTransfer & /* transfer */) {
+    return NULL;
+  }
+
+  /**
+   * Complete a read prepared with prepareFetch().
+   * Returns true if the sample was valid and the values are cached
+   */
+  virtual bool completeFetch(const SHTI2cBus::ReadTransfer & /* transfer */) {
+    return false;
+  }
+
+  /** Returns the duration of one measurement in microseconds */
+  virtual uint16_t getMeasurementDurationMicros() const {
+    return 0;
+  }
+
+  /**
+   * Returns the estimated energy in microjoules the sensor uses for one
+   * sample at `supplyVoltage' volts, or 0 if unknown
+   */
+  virtual float getEnergyPerSample(float /* supplyVoltage */) const {
+    return 0;
+  }
+
+  /** Returns the duration of one measurement in milliseconds, rounded up */
+  uint8_t getMeasurementDuration() const {
+    return (getMeasurementDurationMicros() + 999) / 1000;
+  }
+
+  /** Convert a raw humidity value to hundredths of a percent */
+  virtual int32_t convertHumidityCentiPercent(uint16_t /* rawHumidity */) const {
+    return SHTSensorBase::FIXED_POINT_INVALID;
+  }
+
+  /** Convert a raw temperature value to hundredths of a degree Celsius */
+  virtual int32_t convertTemperatureCentiCelsius(uint16_t /* rawTemperature */) const {
+    return SHTSensorBase::FIXED_POINT_INVALID;
+  }
+
+  /** Convert a raw humidity value to percent */
+  virtual float convertHumidity(uint16_t /* rawHumidity */) const {
+    return SHTSensorBase::HUMIDITY_INVALID;
+  }
+
+  /** Convert a raw temperature value to degrees Celsius */
+  virtual float convertTemperature(uint16_t /* rawTemperature */) const {
+    return SHTSensorBase::TEMPERATURE_INVALID;
+  }
+
+  /**
+   * Convert `count' raw samples, writing to `temperatures' and `humidities'
+   * unless they are NULL
+   */
+  virtual void convertSamples(const SHTSensorBase::SHTRawSample *samples,
+                              uint16_t count, float *temperatures,
+                              float *humidities) const;
+
   /**
    * Get the relative humidity in percent read from the last sample
    * Use readSample() to trigger a new sensor reading
    */
   float getHumidity() const {
-    return mHumidity;
+    return convertHumidity(mRawHumidity);
   }
 
   /**
@@ -190,13 +565,24 @@ public:
    * Use readSample() to trigger a new sensor reading
    */
   float getTemperature() const {
-    return mTemperature;
+    return convertTemperature(mRawTemperature);
   }
 
-  float mTemperature;
-  float mHumidity;
+  /** Raw sensor values of the last sample, 0 until read */
+  uint16_t mRawTemperature;
+  uint16_t mRawHumidity;
+#if SHT_STATISTICS
+  /** Counters of the owning SHTSensor, or NULL */
+  SHTSensorBase::SHTStatistics *mStatistics;
+#endif
 };
 
+// Forward declaration
+template <class Model, uint8_t I2cAddress = Model::I2C_ADDRESS,
+          SHTSensorBase::SHTAccuracy Accuracy = SHTSensorBase::SHT_ACCURACY_HIGH,
+          class Bus = SHTDefaultBus>
+class SHTSensorT;
+
 /** Base class for i2c SHT Sensor drivers */
 class SHTI2cSensor : public SHTSensorDriver {
 public:
@@ -208,20 +594,33 @@ public:
 
   /**
    * Constructor for i2c SHT Sensors
-   * Takes the `i2cAddress' to read, the `i2cCommand' issues when sampling
+   * Takes the `bus' the sensor is connected to, the `i2cAddress' to read, the `i2cCommand' issues when sampling
    * the sensor and the values `a', `b', `c' to convert the fixed-point
    * temperature value received by the sensor to a floating point value using
    * the formula: temperature = a + b * (rawTemperature / c)
    * and the values `x' and `y' to convert the fixed-point humidity value
    * received by the sensor to a floating point value using the formula:
    * humidity = x + y * (rawHumidity / z)
-   * duration is the duration in milliseconds of one measurement
+   * duration is the duration in microseconds of one measurement
+   * typicalDuration is the typical duration in microseconds of one measurement
+   * The fixed-point conversion constants are derived from the same values;
+   * `b' and `y' must be positive and below 655.36.
    */
-  SHTI2cSensor(uint8_t i2cAddress, uint16_t i2cCommand, uint8_t duration,
-               float a, float b, float c,
-               float x, float y, float z, uint8_t cmd_Size)
-      : mI2cAddress(i2cAddress), mI2cCommand(i2cCommand), mDuration(duration),
-        mA(a), mB(b), mC(c), mX(x), mY(y), mZ(z), mCmd_Size(cmd_Size)
+  SHTI2cSensor(SHTI2cBus &bus, uint8_t i2cAddress, uint16_t i2cCommand,
+               uint16_t duration, uint16_t typicalDuration, float a, float b,
+               float c, float x, float y, float z, uint8_t cmd_Size)
+      : mBus(bus), mI2cAddress(i2cAddress), mI2cCommand(i2cCommand), mDuration(duration),
+        mTypicalDuration(typicalDuration),
+        mA(a), mB(b), mC(c), mX(x), mY(y), mZ(z), mCmd_Size(cmd_Size),
+        mMeasurementPending(false), mMeasurementStart(0),
+        mPollForReady(false), mPollInterval(DEFAULT_POLL_INTERVAL),
+        mPollTimeout(0), mLearnDuration(false), mLearningMargin(0),
+        mLearnedDuration(0), mClockStretching(false),
+        mTemperatureOffset(fixedPointOffset(a)),
+        mTemperatureFactor(fixedPointFactor(b, c)),
+        mHumidityOffset(fixedPointOffset(x)),
+        mHumidityFactor(fixedPointFactor(y, z)),
+        mResultLayout(RESULT_SAMPLE)
   {
   }
 
@@ -229,11 +628,53 @@ public:
   {
   }
 
+  virtual bool setReadyPolling(bool enable, uint16_t pollInterval,
+                               uint8_t timeout);
+  virtual bool setDurationLearning(bool enable, uint16_t margin);
   virtual bool readSample();
+  virtual bool readTemperatureOnly();
+  virtual bool startMeasurement();
+  virtual bool isSampleReady() const;
+  virtual bool fetchSample();
+  virtual SHTI2cBus *prepareFetch(SHTI2cBus::ReadTransfer &transfer);
+  virtual bool completeFetch(const SHTI2cBus::ReadTransfer &transfer);
+
+  virtual uint16_t getMeasurementDurationMicros() const {
+    return mDuration;
+  }
+
+  virtual uint16_t getLearnedDuration() const {
+    return mLearnedDuration;
+  }
+
+  virtual int32_t convertHumidityCentiPercent(uint16_t rawHumidity) const {
+    return mHumidityOffset + fixedPointScale(mHumidityFactor, rawHumidity);
+  }
+
+  virtual int32_t convertTemperatureCentiCelsius(uint16_t rawTemperature) const {
+    return mTemperatureOffset + fixedPointScale(mTemperatureFactor,
+                                                rawTemperature);
+  }
+
+  virtual float convertHumidity(uint16_t rawHumidity) const {
+    return mX + mY * (rawHumidity / mZ);
+  }
 
+  virtual float convertTemperature(uint16_t rawTemperature) const {
+    return mA + mB * (rawTemperature / mC);
+  }
+
+  virtual void convertSamples(const SHTSensorBase::SHTRawSample *samples,
+                              uint16_t count, float *temperatures,
+                              float *humidities) const;
+
+  SHTI2cBus &mBus;
   uint8_t mI2cAddress;
   uint16_t mI2cCommand;
-  uint8_t mDuration;
+  /** Duration of one measurement in microseconds */
+  uint16_t mDuration;
+  /** Typical duration of one measurement in microseconds */
+  uint16_t mTypicalDuration;
   float mA;
   float mB;
   float mC;
@@ -241,42 +682,1101 @@ public:
   float mY;
   float mZ;
   uint8_t mCmd_Size;
+  /** True between startMeasurement() and reading its result */
+  bool mMeasurementPending;
+  /** SHTClock::micros() timestamp at which the pending measurement was started */
+  unsigned long mMeasurementStart;
+
+  /** Default time between two reads when polling, in microseconds */
+  static const uint16_t DEFAULT_POLL_INTERVAL = 500;
+  /** Poll for the result after mTypicalDuration in readSample() */
+  bool mPollForReady;
+  /** Time between two reads when polling, in microseconds */
+  uint16_t mPollInterval;
+  /** Time after which polling gives up in milliseconds, 0 for 2 * mDuration */
+  uint8_t mPollTimeout;
+  /** Learn the conversion time and wait mLearnedDuration + mLearningMargin */
+  bool mLearnDuration;
+  uint16_t mLearningMargin;
+  /** Learned duration of one measurement in microseconds, 0 if unknown */
+  uint16_t mLearnedDuration;
+  /**
+   * mI2cCommand makes the sensor stretch the clock until the result is
+   * ready, so readSample() reads right after sending it
+   */
+  bool mClockStretching;
+
+  /**
+   * Fixed-point conversion constants: value in hundredths of the unit is
+   * offset + round(factor * raw / 65535), see fixedPointScale(). With the
+   * coefficients of the supported sensors, offset and factor are integers,
+   * so the value deviates at most 0.5 + 0.00002 hundredths from the exact
+   * result of the conversion formula.
+   */
+  static const uint8_t FIXED_POINT_SHIFT = 16;
+  static const uint32_t FIXED_POINT_ROUNDING = (uint32_t)1 << (FIXED_POINT_SHIFT - 1);
+  int32_t mTemperatureOffset;
+  uint32_t mTemperatureFactor;
+  int32_t mHumidityOffset;
+  uint32_t mHumidityFactor;
+
+protected:
+  /** Values in the result of a measurement */
+  enum ResultLayout {
+    /** Temperature followed by humidity */
+    RESULT_SAMPLE,
+    /** Only the first word of a temperature first measurement */
+    RESULT_TEMPERATURE,
+    /** Only the first word of a humidity first measurement */
+    RESULT_HUMIDITY
+  };
+
+  /**
+   * Measure with `command' and read the values of `layout', waiting,
+   * polling or reading with clock stretching as configured
+   */
+  virtual bool measure(uint16_t command, ResultLayout layout);
+
+  /** Send a command of mCmd_Size bytes to the sensor */
+  bool sendCommand(uint16_t command);
+
+  /**
+   * Send `i2cCommand', wait `duration' microseconds and read `dataLength'
+   * bytes of words followed by their CRC. Returns true if all CRCs match.
+   * Used to read identification registers when detecting sensors.
+   */
+  static bool readWords(SHTI2cBus &bus, uint8_t i2cAddress,
+                        const uint8_t *i2cCommand,
+                        uint8_t commandLength, uint8_t *data,
+                        uint8_t dataLength, uint16_t duration);
 
-private:
   static uint8_t crc8(const uint8_t *data, uint8_t len);
-  static bool readFromI2c(uint8_t i2cAddress,
+  static bool readFromI2c(SHTI2cBus &bus, uint8_t i2cAddress,
                           const uint8_t *i2cCommand,
                           uint8_t commandLength, uint8_t *data,
-                          uint8_t dataLength, uint8_t duration);
-};
+                          uint8_t dataLength, uint16_t duration);
+private:
+  /** Layout of the result of the pending measurement */
+  ResultLayout mResultLayout;
 
-class SHT3xAnalogSensor
-{
-public:
+  uint8_t resultLength() const {
+    return mResultLayout == RESULT_SAMPLE ? EXPECTED_DATA_SIZE
+                                          : EXPECTED_DATA_SIZE / 2;
+  }
+
+  bool sendMeasurementCommand(uint16_t command);
+  bool readMeasurementResult();
+  bool pollMeasurementResult(uint16_t wait);
+  bool processMeasurementResult(const uint8_t *data);
+  static void encodeCommand(uint16_t command, uint8_t *cmd);
+
+  // SHTLinuxI2cBus checks the CRC of reads that ignored a NACK
+  friend class SHTLinuxI2cBus;
+
+  // SHTSensorT shares the CRC and conversion helpers
+  template <class Model, uint8_t I2cAddress, SHTSensorBase::SHTAccuracy Accuracy,
+            class Bus>
+  friend class SHTSensorT;
+
+  static constexpr int32_t fixedPointOffset(float offset) {
+    return (int32_t)(offset * 100 + (offset < 0 ? -0.5f : 0.5f));
+  }
+
+  static constexpr uint32_t fixedPointFactor(float scale, float divisor) {
+    return (uint32_t)(scale * 100 * 65535 / divisor + 0.5f);
+  }
 
   /**
-   * Instantiate a new Sensirion SHT3x Analog sensor driver instance.
-   * The required paramters are `humidityPin` and `temperaturePin`
-   * An optional `readResolutionBits' can be set since the Arduino/Genuino Zero
-   * support 12bit precision analog readings. By default, 10 bit precision is
-   * used.
-   *
-   * Example usage:
-   * SHT3xAnalogSensor sht3xAnalog(HUMIDITY_PIN, TEMPERATURE_PIN);
-   * float humidity = sht.readHumidity();
-   * float temperature = sht.readTemperature();
+   * round(factor * raw / 65535) without a division: with x = factor * raw,
+   * x / 65535 = (x + x / 65535) / 65536, and x >> 16 stands in for x / 65535
+   * with an error below 1.27, i.e. 0.00002 after the final shift
    */
-  SHT3xAnalogSensor(uint8_t humidityPin, uint8_t temperaturePin,
-                    uint8_t readResolutionBits = 10)
-      : mHumidityAdcPin(humidityPin), mTemperatureAdcPin(temperaturePin),
-        mReadResolutionBits(readResolutionBits)
-  {
+  static int32_t fixedPointScale(uint32_t factor, uint16_t raw) {
+    uint32_t x = factor * raw;
+    return (int32_t)((x + (x >> FIXED_POINT_SHIFT) + FIXED_POINT_ROUNDING) >>
+                     FIXED_POINT_SHIFT);
   }
 
-  virtual ~SHT3xAnalogSensor()
+};
+
+/** Driver for the SHTC1, SHTW1 and SHTW2 */
+class SHTC1Sensor : public SHTI2cSensor
+{
+private:
+    // high precision, T first
+    static const uint16_t SHTC1_MEASURE                 = 0x7866;
+    static const uint16_t SHTC1_MEASURE_CLOCK_STRETCHING = 0x7CA2;
+    // high precision, RH first
+    static const uint16_t SHTC1_MEASURE_HUMIDITY_FIRST   = 0x58E0;
+    static const uint16_t SHTC1_MEASURE_HUMIDITY_FIRST_CLOCK_STRETCHING = 0x5C24;
+
+public:
+    static const uint8_t SHTC1_I2C_ADDRESS = 0x70;
+
+    SHTC1Sensor(SHTI2cBus &bus)
+        : SHTI2cSensor(bus, SHTC1_I2C_ADDRESS, SHTC1_MEASURE, 14400, 10800,
+                       -45, 175, 65535, 0, 100, 65535, 2),
+          mHumidityFirstCommand(SHTC1_MEASURE_HUMIDITY_FIRST)
+    {
+    }
+
+    virtual bool setClockStretching(bool enable);
+    virtual bool readHumidityOnly();
+
+    /** Returns true if the sensor at the address is of the SHTC1 family */
+    static bool detect(SHTI2cBus &bus);
+
+protected:
+    /** Command measuring the humidity first in the current mode */
+    uint16_t mHumidityFirstCommand;
+
+    /**
+     * Read the ID register into `id', waking up a sleeping SHTC3 first
+     * Returns true if the ID was read
+     */
+    static bool readId(SHTI2cBus &bus, uint16_t &id);
+
+    static const uint16_t SHTC3_WAKEUP          = 0x3517;
+    // time the SHTC3 needs to wake up, in microseconds
+    static const uint16_t SHTC3_WAKEUP_DURATION = 240;
+};
+
+/**
+ * Driver for the SHTC3
+ *
+ * The sensor is put to sleep after each sample and woken up for the next
+ * measurement, which cuts its supply current between samples from about
+ * 45uA to 0.3uA. SHT_ACCURACY_LOW selects the low power measurement mode.
+ */
+class SHTC3Sensor : public SHTC1Sensor
+{
+private:
+    static const uint16_t SHTC3_SLEEP = 0xB098;
+    // T first, without and with clock stretching
+    static const uint16_t SHTC3_MEASURE_NORMAL                     = 0x7866;
+    static const uint16_t SHTC3_MEASURE_NORMAL_CLOCK_STRETCHING    = 0x7CA2;
+    static const uint16_t SHTC3_MEASURE_LOW_POWER                  = 0x609C;
+    static const uint16_t SHTC3_MEASURE_LOW_POWER_CLOCK_STRETCHING = 0x6458;
+    // RH first, without and with clock stretching
+    static const uint16_t SHTC3_MEASURE_NORMAL_HUMIDITY_FIRST                     = 0x58E0;
+    static const uint16_t SHTC3_MEASURE_NORMAL_HUMIDITY_FIRST_CLOCK_STRETCHING    = 0x5C24;
+    static const uint16_t SHTC3_MEASURE_LOW_POWER_HUMIDITY_FIRST                  = 0x401A;
+    static const uint16_t SHTC3_MEASURE_LOW_POWER_HUMIDITY_FIRST_CLOCK_STRETCHING = 0x44DE;
+
+    // worst case and typical durations in microseconds
+    static const uint16_t SHTC3_NORMAL_DURATION            = 12100;
+    static const uint16_t SHTC3_NORMAL_TYPICAL_DURATION    = 10800;
+    static const uint16_t SHTC3_LOW_POWER_DURATION         = 800;
+    static const uint16_t SHTC3_LOW_POWER_TYPICAL_DURATION = 700;
+
+    // typical supply currents in microamperes
+    static const uint16_t SHTC3_MEASUREMENT_CURRENT = 430;
+    static const uint16_t SHTC3_IDLE_CURRENT        = 45;
+
+    SHTSensorBase::SHTAccuracy mAccuracy;
+
+    void wakeUp();
+    void sleep();
+
+public:
+    SHTC3Sensor(SHTI2cBus &bus)
+        : SHTC1Sensor(bus),
+          mAccuracy(SHTSensorBase::SHT_ACCURACY_HIGH)
+    {
+      mDuration = SHTC3_NORMAL_DURATION;
+      mTypicalDuration = SHTC3_NORMAL_TYPICAL_DURATION;
+    }
+
+    /** Returns true if the sensor at the address is an SHTC3 */
+    static bool detect(SHTI2cBus &bus);
+
+    /** SHT_ACCURACY_HIGH for the normal mode, SHT_ACCURACY_LOW for low power */
+    virtual bool setAccuracy(SHTSensorBase::SHTAccuracy newAccuracy);
+    virtual bool setClockStretching(bool enable);
+
+    virtual bool startMeasurement();
+    virtual bool fetchSample();
+    virtual bool completeFetch(const SHTI2cBus::ReadTransfer &transfer);
+
+    virtual float getEnergyPerSample(float supplyVoltage) const;
+
+protected:
+    virtual bool measure(uint16_t command, ResultLayout layout);
+};
+
+/** Driver for the SHT3x-DIS */
+class SHT3xSensor : public SHTI2cSensor
+{
+private:
+  static const uint16_t SHT3X_ACCURACY_HIGH    = 0x2400;
+  static const uint16_t SHT3X_ACCURACY_MEDIUM  = 0x240b;
+  static const uint16_t SHT3X_ACCURACY_LOW     = 0x2416;
+  // the same with clock stretching enabled
+  static const uint16_t SHT3X_ACCURACY_HIGH_CLOCK_STRETCHING   = 0x2C06;
+  static const uint16_t SHT3X_ACCURACY_MEDIUM_CLOCK_STRETCHING = 0x2C0D;
+  static const uint16_t SHT3X_ACCURACY_LOW_CLOCK_STRETCHING    = 0x2C10;
+
+  // worst case durations in microseconds
+  static const uint16_t SHT3X_ACCURACY_HIGH_DURATION   = 15000;
+  static const uint16_t SHT3X_ACCURACY_MEDIUM_DURATION = 6000;
+  static const uint16_t SHT3X_ACCURACY_LOW_DURATION    = 4000;
+
+  static const uint16_t SHT3X_ACCURACY_HIGH_TYPICAL_DURATION   = 12500;
+  static const uint16_t SHT3X_ACCURACY_MEDIUM_TYPICAL_DURATION = 4500;
+  static const uint16_t SHT3X_ACCURACY_LOW_TYPICAL_DURATION    = 2500;
+
+  // periodic mode commands, indexed by SHTPeriodicRate and SHTAccuracy
+  static const uint16_t SHT3X_PERIODIC_COMMANDS[][3];
+  static const uint16_t SHT3X_FETCH_DATA       = 0xE000;
+  static const uint16_t SHT3X_BREAK            = 0x3093;
+  // time the sensor needs to abort the periodic mode after a break
+  static const uint8_t SHT3X_BREAK_DURATION    = 1;
+
+  SHTSensorBase::SHTAccuracy mAccuracy;
+  SHTSensorBase::SHTPeriodicRate mPeriodicRate;
+  bool mPeriodic;
+  /**
+   * False until a break stopped any periodic mode started before a reset of
+   * the host, which makes the sensor reject the single shot commands
+   */
+  bool mModeKnown;
+
+  bool sendBreak();
+  void stopStalePeriodicMode();
+
+public:
+  static const uint8_t SHT3X_I2C_ADDRESS_44 = 0x44;
+  static const uint8_t SHT3X_I2C_ADDRESS_45 = 0x45;
+
+  /** Returns true if the sensor at `i2cAddress' is an SHT3x */
+  static bool detect(SHTI2cBus &bus, uint8_t i2cAddress);
+
+  SHT3xSensor(SHTI2cBus &bus, uint8_t i2cAddress = SHT3X_I2C_ADDRESS_44)
+      : SHTI2cSensor(bus, i2cAddress, SHT3X_ACCURACY_HIGH,
+                     SHT3X_ACCURACY_HIGH_DURATION,
+                     SHT3X_ACCURACY_HIGH_TYPICAL_DURATION,
+                     -45, 175, 65535, 0, 100, 65535, 2),
+        mAccuracy(SHTSensorBase::SHT_ACCURACY_HIGH),
+        mPeriodicRate(SHTSensorBase::SHT_PERIODIC_1_MPS),
+        mPeriodic(false),
+        mModeKnown(false)
+  {
+  }
+
+  virtual bool setAccuracy(SHTSensorBase::SHTAccuracy newAccuracy);
+
+  virtual bool setClockStretching(bool enable);
+
+  virtual bool startPeriodicMeasurement(SHTSensorBase::SHTPeriodicRate rate);
+
+  virtual bool stopPeriodicMeasurement();
+
+  virtual bool startMeasurement();
+
+protected:
+  virtual bool measure(uint16_t command, ResultLayout layout);
+};
+
+/** Driver for the SHT4x */
+class SHT4xSensor : public SHTI2cSensor
+{
+private:
+  static const uint16_t SHT4X_ACCURACY_HIGH    = 0xFD00;
+  static const uint16_t SHT4X_ACCURACY_MEDIUM  = 0xF600;
+  static const uint16_t SHT4X_ACCURACY_LOW     = 0xE000;
+
+  // worst case durations in microseconds
+  static const uint16_t SHT4X_ACCURACY_HIGH_DURATION   = 8300;
+  static const uint16_t SHT4X_ACCURACY_MEDIUM_DURATION = 4500;
+  static const uint16_t SHT4X_ACCURACY_LOW_DURATION    = 1700;
+
+  static const uint16_t SHT4X_ACCURACY_HIGH_TYPICAL_DURATION   = 6900;
+  static const uint16_t SHT4X_ACCURACY_MEDIUM_TYPICAL_DURATION = 3700;
+  static const uint16_t SHT4X_ACCURACY_LOW_TYPICAL_DURATION    = 1300;
+
+public:
+  static const uint8_t SHT4X_I2C_ADDRESS_44 = 0x44;
+  static const uint8_t SHT4X_I2C_ADDRESS_45 = 0x45;
+
+  /** Returns true if the sensor at `i2cAddress' is an SHT4x */
+  static bool detect(SHTI2cBus &bus, uint8_t i2cAddress);
+
+  SHT4xSensor(SHTI2cBus &bus, uint8_t i2cAddress = SHT4X_I2C_ADDRESS_44)
+      : SHTI2cSensor(bus, i2cAddress, SHT4X_ACCURACY_HIGH,
+                     SHT4X_ACCURACY_HIGH_DURATION,
+                     SHT4X_ACCURACY_HIGH_TYPICAL_DURATION,
+                     -45, 175, 65535, -6, 125, 65535, 1)
+  {
+  }
+
+  virtual bool setAccuracy(SHTSensorBase::SHTAccuracy newAccuracy);
+};
+
+// Forward declaration
+class SHTSensor;
+
+/**
+ * Receiver of the samples an SHTSensor reads, see SHTSensor::addSampleSink()
+ *
+ * A sink can be attached to one sensor at a time.
+ */
+class SHTSampleSink
+{
+public:
+  SHTSampleSink()
+      : mOwner(NULL),
+        mNextSink(NULL)
   {
   }
 
+  virtual ~SHTSampleSink()
+  {
+  }
+
+  // no heap allocation: only the placement form of operator new is available
+  static void *operator new(size_t, void *where) {
+    return where;
+  }
+  static void operator delete(void *, void *) {
+  }
+  // only referenced by the deleting destructor, never called
+  static void operator delete(void *) {
+  }
+
+  /**
+   * Called after `sensor' read a sample successfully, with the raw values
+   * `sample'. Not called after readTemperatureOnly() or readHumidityOnly(),
+   * which read only one of the values.
+   */
+  virtual void addSample(const SHTSensor &sensor,
+                         const SHTSensorBase::SHTRawSample &sample) = 0;
+
+protected:
+  /** Sensor the sink is attached to, or NULL */
+  const SHTSensor *getOwner() const {
+    return mOwner;
+  }
+
+private:
+  // SHTSensor keeps its sinks in a list linked through the sinks
+  friend class SHTSensor;
+  // sensor the sink is attached to, or NULL
+  const SHTSensor *mOwner;
+  SHTSampleSink *mNextSink;
+};
+
+/**
+ * Official interface for Sensirion SHT Sensors
+ */
+class SHTSensor : public SHTSensorBase
+{
+public:
+  /**
+   * Auto-detectable sensor types.
+   * The SHTC3 is tried before the SHTC1 so it gets its own driver with sleep
+   * support. Note that the SHTW1 and SHTW2 share exactly the same driver as
+   * the SHTC1 and are thus not listed individually.
+   */
+  static const SHTSensorType AUTO_DETECT_SENSORS[];
+
+  /** Sensor found on the bus by scanBus() */
+  struct SHTSensorInfo {
+    SHTSensorType sensorType;
+    uint8_t i2cAddress;
+  };
+
+  /** Sensors found on the bus by scanBus() */
+  struct SHTScanResult {
+    /** One sensor per i2c address used by SHT Sensors: 0x44, 0x45 and 0x70 */
+    static const uint8_t MAX_SENSORS = 3;
+    SHTSensorInfo sensors[MAX_SENSORS];
+    /** Number of valid entries in `sensors' */
+    uint8_t count;
+  };
+
+  /**
+   * Instantiate a new SHTSensor
+   * By default, the i2c bus is queried for known SHT Sensors. To address
+   * a specific sensor, set the `sensorType'. The optional `i2cAddress'
+   * overrides the default address of the sensor type, e.g. 0x45 for an SHT4x-B.
+   * Sensors of the SHTC1 family have a fixed address and ignore it.
+   * The sensor is accessed through the default bus, see SHTI2cBus::getDefault().
+   */
+  SHTSensor(SHTSensorType sensorType = AUTO_DETECT, uint8_t i2cAddress = 0)
+      : SHTSensor(SHTI2cBus::getDefault(), sensorType, i2cAddress)
+  {
+  }
+
+  /**
+   * Instantiate a new SHTSensor on the i2c `bus'
+   * See SHTSensor() for the other arguments.
+   */
+  SHTSensor(SHTI2cBus &bus, SHTSensorType sensorType = AUTO_DETECT,
+            uint8_t i2cAddress = 0)
+      : SHTSensor(&bus, sensorType, i2cAddress)
+  {
+  }
+
+  /**
+   * Instantiate a new SHTSensor for a sensor found by scanBus()
+   * init() then sets up the driver for this sensor without probing the bus.
+   */
+  SHTSensor(const SHTSensorInfo &info)
+      : SHTSensor(SHTI2cBus::getDefault(), info.sensorType, info.i2cAddress)
+  {
+  }
+
+  /**
+   * Instantiate a new SHTSensor for a sensor found by scanBus(bus)
+   */
+  SHTSensor(SHTI2cBus &bus, const SHTSensorInfo &info)
+      : SHTSensor(&bus, info.sensorType, info.i2cAddress)
+  {
+  }
+
+  virtual ~SHTSensor() {
+    cleanup();
+    releaseSampleSinks();
+  }
+
+  // no heap allocation: only the placement form of operator new is available
+  static void *operator new(size_t, void *where) {
+    return where;
+  }
+  static void operator delete(void *, void *) {
+  }
+  // only referenced by the deleting destructor, never called
+  static void operator delete(void *) {
+  }
+
+  /**
+   * Find all SHT Sensors on the bus
+   * Unlike AUTO_DETECT, which stops at the first sensor found, every i2c
+   * address used by SHT Sensors is probed once and the type of each sensor
+   * acknowledging its address is identified by its ID.
+   * Pass the entries of the result to SHTSensor() to use the sensors.
+   *
+   * Example usage:
+   * SHTSensor::SHTScanResult scan = SHTSensor::scanBus();
+   * for (uint8_t i = 0; i < scan.count; ++i) {
+   *   Serial.println(scan.sensors[i].i2cAddress, HEX);
+   * }
+   */
+  static SHTScanResult scanBus();
+
+  /** Find all SHT Sensors on the i2c `bus', see scanBus() */
+  static SHTScanResult scanBus(SHTI2cBus &bus);
+
+  /**
+   * Initialize the sensor driver, and probe for the sensor on the bus
+   *
+   * If SHTSensor() was created with an empty constructor or with 'sensorType'
+   * AUTO_DETECT, init() will also try to automatically detect a sensor.
+   * Auto detection will stop as soon as the first sensor was found; if you have
+   * multiple sensor types on the bus, use the 'sensorType' argument of the
+   * constructor to control which sensor type will be instantiated.
+   * Auto detection only queries the ID of sensors acknowledging their i2c
+   * address and thus completes within a few milliseconds.
+   *
+   * To read out the sensor use readSample(), followed by getTemperature() and
+   * getHumidity() to retrieve the values from the sample
+   *
+   * Returns true if communication with a sensor on the bus was successful, false otherwise
+   */
+  bool init();
+
+  /**
+   * Read new values from the sensor
+   * After the call, use getTemperature() and getHumidity() to retrieve the
+   * values
+   * Returns true if the sample was read and the values are cached
+   */
+  bool readSample();
+
+  /**
+   * Read only the temperature of a new sample
+   * Transfers half the bytes of readSample() by stopping after the first
+   * word of the result. getHumidity() keeps returning the humidity of the
+   * last sample that included it.
+   * Returns true if the temperature was read and is cached
+   */
+  bool readTemperatureOnly();
+
+  /**
+   * Read only the humidity of a new sample, see readTemperatureOnly()
+   * Only the SHTC1 family can measure the humidity first; returns false
+   * for the other sensors
+   */
+  bool readHumidityOnly();
+
+  /**
+   * Trigger a new measurement without waiting for its completion
+   * Use isSampleReady() to check whether the conversion time has passed and
+   * fetchSample() to read the values once it has. This allows doing other
+   * work while the sensor is measuring instead of blocking in readSample().
+   * Returns true if the measurement command was acknowledged by the sensor
+   */
+  bool startMeasurement();
+
+  /**
+   * Returns true if a measurement started with startMeasurement() has
+   * completed and can be read with fetchSample()
+   */
+  bool isSampleReady() const;
+
+  /**
+   * Read the values of a measurement started with startMeasurement()
+   * After the call, use getTemperature() and getHumidity() to retrieve the
+   * values
+   * Returns true if the sample was read and the values are cached, false if
+   * no measurement is pending, it has not completed yet or reading failed
+   */
+  bool fetchSample();
+
+  /**
+   * Get the relative humidity in percent read from the last sample
+   * Use readSample() to trigger a new sensor reading
+   * The raw value is converted on each call.
+   * Returns HUMIDITY_INVALID if no humidity was read
+   */
+  float getHumidity() const;
+
+  /**
+   * Get the temperature in Celsius read from the last sample
+   * Use readSample() to trigger a new sensor reading
+   * The raw value is converted on each call.
+   * Returns TEMPERATURE_INVALID if no temperature was read
+   */
+  float getTemperature() const;
+
+  /**
+   * Get the raw values of the last sample
+   * Storing 4 byte raw samples and converting them only when needed with
+   * convertTemperature(), convertHumidity() or convertSamples() saves
+   * buffer space and time. Values that were not read yet are 0.
+   */
+  SHTRawSample getRawSample() const {
+    SHTRawSample sample = { mRawTemperature, mRawHumidity };
+    return sample;
+  }
+
+  /**
+   * Convert a raw humidity value read by this sensor to percent
+   * Returns HUMIDITY_INVALID if the sensor is not initialized
+   */
+  float convertHumidity(uint16_t rawHumidity) const;
+
+  /**
+   * Convert a raw temperature value read by this sensor to degrees Celsius
+   * Returns TEMPERATURE_INVALID if the sensor is not initialized
+   */
+  float convertTemperature(uint16_t rawTemperature) const;
+
+  /**
+   * Convert `count' raw samples read by this sensor at once
+   * The results are written to `temperatures' and `humidities', either of
+   * which may be NULL if the values are not needed.
+   * Returns false if the sensor is not initialized
+   */
+  bool convertSamples(const SHTRawSample *samples, uint16_t count,
+                      float *temperatures, float *humidities) const;
+
+  /**
+   * Get the relative humidity in hundredths of a percent read from the last
+   * sample, e.g. 4512 for 45.12 %RH. The value is converted with integer
+   * arithmetic only, which is considerably faster than getHumidity() on
+   * microcontrollers without a floating point unit. It is rounded to the
+   * nearest hundredth, i.e. deviates at most 0.5 hundredths (plus 0.00002)
+   * from the exact conversion.
+   * Returns FIXED_POINT_INVALID if no sample was read
+   */
+  int32_t getHumidityCentiPercent() const;
+
+  /**
+   * Get the temperature in hundredths of a degree Celsius read from the last
+   * sample, e.g. 2346 for 23.46 degrees Celsius. The value is converted with
+   * integer arithmetic only, see getHumidityCentiPercent().
+   * Returns FIXED_POINT_INVALID if no sample was read
+   */
+  int32_t getTemperatureCentiCelsius() const;
+
+  /**
+   * Change the sensor accurancy, if supported by the sensor
+   * Returns true if the accuracy was changed
+   */
+  bool setAccuracy(SHTAccuracy newAccuracy);
+
+  /**
+   * Start the periodic acquisition mode, if supported by the sensor
+   * The sensor then measures on its own at the given `rate' using the current
+   * accuracy setting, and readSample() fetches the latest result from the
+   * sensor's buffer without waiting for a conversion. readSample() returns
+   * false if no new result was measured since the last read.
+   * Returns true if the periodic mode was started
+   */
+  bool startPeriodicMeasurement(SHTPeriodicRate rate);
+
+  /**
+   * Stop the periodic acquisition mode and return to single shot measurements
+   * Returns true if the periodic mode was stopped
+   */
+  bool stopPeriodicMeasurement();
+
+  /**
+   * Get the time in milliseconds the sensor needs to complete a measurement
+   * with the current settings, rounded up, or 0 if the sensor is not
+   * initialized
+   */
+  uint8_t getMeasurementDuration() const;
+
+  /**
+   * Get the time in microseconds the sensor needs to complete a measurement
+   * with the current settings, or 0 if the sensor is not initialized
+   */
+  uint16_t getMeasurementDurationMicros() const;
+
+  /**
+   * Get the estimated energy in microjoules the sensor uses for one sample
+   * with the current settings at `supplyVoltage' volts, or 0 if unknown.
+   * Only known for the SHTC3.
+   */
+  float getEnergyPerSample(float supplyVoltage = 3.3f) const;
+
+  /**
+   * Make readSample() poll for the result instead of waiting for the worst
+   * case conversion time: the sensor does not acknowledge reads before the
+   * result is ready, so after the typical conversion time the result is read
+   * every `pollInterval' microseconds until the sensor answers, or until
+   * `timeout' milliseconds after the start of the measurement (0 for twice the
+   * worst case conversion time). This lowers the average latency of a sample.
+   * Must be called after init(). Not used in the periodic mode.
+   * Returns false if the sensor does not support polling
+   */
+  bool setReadyPolling(bool enable, uint16_t pollInterval = 500,
+                       uint8_t timeout = 0);
+
+  /**
+   * Use the measurement commands with clock stretching: the sensor holds the
+   * clock line low until the result is ready, so readSample() reads right
+   * after the command without waiting or polling. Only enable this if the
+   * i2c controller supports clock stretching for the whole conversion time,
+   * up to 15 milliseconds. Supported by the SHT3x and the SHTC1 family.
+   * Must be called after init().
+   * Returns false if the sensor does not support clock stretching
+   */
+  bool setClockStretching(bool enable);
+
+  /**
+   * Make readSample() learn how long the conversions of this sensor take:
+   * results are polled for as with setReadyPolling(), and the time at which
+   * they become ready is tracked. Later reads wait for the learned time plus
+   * `margin' microseconds and only poll if the result is not ready then. The
+   * estimate follows late results immediately and shrinks slowly while the
+   * results are in time. Changing the accuracy restarts learning.
+   * Must be called after init(). Not used in the periodic mode.
+   * Returns false if the sensor does not support it
+   */
+  bool setDurationLearning(bool enable, uint16_t margin = 200);
+
+  /**
+   * Get the learned conversion time in microseconds, or 0 if none was learned
+   * yet, see setDurationLearning()
+   */
+  uint16_t getLearnedDuration() const;
+
+  /**
+   * Pass every complete sample read from now on to `sink', e.g. an
+   * SHTSampleHistory
+   * Sinks are called in the order they were added, after the values of the
+   * sensor have been updated. The sink must stay valid until it is removed
+   * or the sensor is destroyed.
+   * Returns false if `sink' is attached to this or another sensor already
+   */
+  bool addSampleSink(SHTSampleSink &sink);
+
+  /**
+   * Stop passing samples to `sink', which can then be added to any sensor;
+   * returns false if it was not added to this sensor
+   */
+  bool removeSampleSink(SHTSampleSink &sink);
+
+#if SHT_STATISTICS
+  /**
+   * Get the counters of the reads of this sensor since its construction or
+   * the last resetStatistics()
+   */
+  const SHTStatistics &getStatistics() const {
+    return mStatistics;
+  }
+
+  /** Reset all read counters to zero */
+  void resetStatistics();
+#endif /* SHT_STATISTICS */
+
+  SHTSensorType mSensorType;
+  /** i2c address of the sensor, or 0 to use the default of mSensorType */
+  uint8_t mI2cAddress;
+
+private:
+  SHTSensor(SHTI2cBus *bus, SHTSensorType sensorType, uint8_t i2cAddress)
+      : mSensorType(sensorType),
+        mI2cAddress(i2cAddress),
+        mBus(bus),
+        mSensor(NULL),
+        mRawTemperature(0),
+        mRawHumidity(0),
+        mHasTemperature(false),
+        mHasHumidity(false),
+        mSampleSinks(NULL)
+  {
+#if SHT_STATISTICS
+    resetStatistics();
+#endif
+  }
+
+  // driver storage holds a single SHTSensorDriver; copies would alias it
+  SHTSensor(const SHTSensor &);
+  SHTSensor &operator=(const SHTSensor &);
+
+  void cleanup();
+  void releaseSampleSinks();
+  bool readValues(bool temperature, bool humidity);
+  void copySample(bool temperature = true, bool humidity = true);
+  static bool detect(SHTI2cBus &bus, SHTSensorType sensorType);
+
+  // SHTSensorGroup batches the reads of its members
+  friend class SHTSensorGroup;
+  SHTI2cBus *prepareFetch(SHTI2cBus::ReadTransfer &transfer);
+  bool completeFetch(const SHTI2cBus::ReadTransfer &transfer);
+
+  /** In-object storage for the driver of any supported sensor type */
+  union DriverStorage {
+    DriverStorage() {}
+    ~DriverStorage() {}
+    SHTC1Sensor shtc1;
+    SHTC3Sensor shtc3;
+    SHT3xSensor sht3x;
+    SHT4xSensor sht4x;
+  };
+
+  /** Bus the sensor is connected to, or NULL if there is none */
+  SHTI2cBus *mBus;
+  DriverStorage mDriver;
+  /** Driver constructed in mDriver, or NULL if not initialized */
+  SHTSensorDriver *mSensor;
+  uint16_t mRawTemperature;
+  uint16_t mRawHumidity;
+  bool mHasTemperature;
+  bool mHasHumidity;
+  /** First of the sinks linked through SHTSampleSink::mNextSink, or NULL */
+  SHTSampleSink *mSampleSinks;
+
+#if SHT_STATISTICS
+  void countRead(bool success);
+  void countLatency(unsigned long latency);
+
+  SHTStatistics mStatistics;
+#endif
+};
+
+/**
+ * Group of digital SHT Sensors that are measured together
+ *
+ * Instead of measuring the sensors one after the other, the measurement is
+ * started on all sensors first, then the group waits once for the slowest
+ * sensor and reads all results. A round thus only takes the conversion time of
+ * one measurement plus the bus time, independent of the number of sensors.
+ */
+class SHTSensorGroup
+{
+public:
+  /** Maximum number of sensors in a group */
+  static const uint8_t MAX_SENSORS = 32;
+  /**
+   * Maximum number of results collected in one batch read of a bus, see
+   * SHT_GROUP_BATCH_SIZE; more sensors on a bus take several batches
+   */
+  static const uint8_t BATCH_SIZE = SHT_GROUP_BATCH_SIZE;
+
+  /**
+   * Instantiate a new sensor group of the `count' initialized sensors in the
+   * array `sensors'. The array is not copied and must outlive the group.
+   * Sensors beyond MAX_SENSORS are ignored.
+   *
+   * Example usage:
+   * SHTSensor *sensors[] = { &sht1, &sht2 };
+   * SHTSensorGroup group(sensors, 2);
+   */
+  SHTSensorGroup(SHTSensor *sensors[], uint8_t count)
+      : mSensors(sensors),
+        mCount(count < MAX_SENSORS ? count : MAX_SENSORS),
+        mValidSamples(0)
+  {
+  }
+
+  /**
+   * Read new values from all sensors of the group
+   * The results of sensors sharing a bus are collected with
+   * SHTI2cBus::readBatch(), i.e. in a single transaction on buses supporting it.
+   * After the call, use isSampleValid() to check which sensors were read and
+   * getTemperature() and getHumidity() of those sensors to retrieve the values
+   * Returns true if the samples of all sensors were read
+   */
+  bool readSample();
+
+  /**
+   * Returns true if the sensor at `index' was read successfully by the last
+   * call to readSample()
+   */
+  bool isSampleValid(uint8_t index) const {
+    return index < mCount && (mValidSamples & ((uint32_t)1 << index));
+  }
+
+  /**
+   * Get a bit mask of the sensors read successfully by the last call to
+   * readSample(), with bit n set if the sensor at index n was read
+   */
+  uint32_t getValidSamples() const {
+    return mValidSamples;
+  }
+
+  /** Get the number of sensors in the group */
+  uint8_t getSensorCount() const {
+    return mCount;
+  }
+
+private:
+  SHTSensor **mSensors;
+  uint8_t mCount;
+  uint32_t mValidSamples;
+};
+
+/**
+ * Compile-time sensor models for SHTSensorT
+ *
+ * Each model describes a sensor family with its default i2c address, the size
+ * of its commands, the command and duration in microseconds of a measurement
+ * for each accuracy, and the conversion coefficients as described in
+ * SHTI2cSensor().
+ */
+
+/** SHT3x-DIS (0x44 with ADDR connected to VSS, 0x45 with ADDR to VDD) */
+struct SHT3x {
+  static const uint8_t I2C_ADDRESS = 0x44;
+  static const uint8_t COMMAND_SIZE = 2;
+  static constexpr uint16_t command(SHTSensor::SHTAccuracy accuracy) {
+    return accuracy == SHTSensor::SHT_ACCURACY_HIGH   ? 0x2400 :
+           accuracy == SHTSensor::SHT_ACCURACY_MEDIUM ? 0x240b : 0x2416;
+  }
+  static constexpr uint16_t duration(SHTSensor::SHTAccuracy accuracy) {
+    return accuracy == SHTSensor::SHT_ACCURACY_HIGH   ? 15000 :
+           accuracy == SHTSensor::SHT_ACCURACY_MEDIUM ? 6000 : 4000;
+  }
+  static constexpr float A = -45, B = 175, C = 65535;
+  static constexpr float X = 0, Y = 100, Z = 65535;
+};
+
+/** SHT4x (0x44 for SHT4x-A, 0x45 for SHT4x-B) */
+struct SHT4x {
+  static const uint8_t I2C_ADDRESS = 0x44;
+  static const uint8_t COMMAND_SIZE = 1;
+  static constexpr uint16_t command(SHTSensor::SHTAccuracy accuracy) {
+    return accuracy == SHTSensor::SHT_ACCURACY_HIGH   ? 0xFD00 :
+           accuracy == SHTSensor::SHT_ACCURACY_MEDIUM ? 0xF600 : 0xE000;
+  }
+  static constexpr uint16_t duration(SHTSensor::SHTAccuracy accuracy) {
+    return accuracy == SHTSensor::SHT_ACCURACY_HIGH   ? 8300 :
+           accuracy == SHTSensor::SHT_ACCURACY_MEDIUM ? 4500 : 1700;
+  }
+  static constexpr float A = -45, B = 175, C = 65535;
+  static constexpr float X = -6, Y = 125, Z = 65535;
+};
+
+/** SHTC1, SHTC3, SHTW1 and SHTW2; the accuracy cannot be changed */
+struct SHTC1 {
+  static const uint8_t I2C_ADDRESS = 0x70;
+  static const uint8_t COMMAND_SIZE = 2;
+  // clock stretching disabled, high precision, T first
+  static constexpr uint16_t command(SHTSensor::SHTAccuracy) {
+    return 0x7866;
+  }
+  static constexpr uint16_t duration(SHTSensor::SHTAccuracy) {
+    return 14400;
+  }
+  static constexpr float A = -45, B = 175, C = 65535;
+  static constexpr float X = 0, Y = 100, Z = 65535;
+};
+
+/**
+ * Digital SHT Sensor with its model, address, accuracy and bus type fixed at
+ * compile time
+ *
+ * Unlike SHTSensor, no driver is allocated: the command, measurement
+ * duration and conversion coefficients are compile-time constants, and only
+ * the code of the models in use ends up in the binary. The bus is accessed
+ * through the `Bus' class, SHTWireBus by default on Arduino. As SHTWireBus is
+ * final, its functions are called directly instead of through the virtual
+ * functions of SHTI2cBus. Waiting for the measurement still goes through the
+ * current SHTClock, and the CRC check is shared with SHTSensor. Use SHTSensor
+ * if the sensor type is only known at runtime, e.g. for auto detection.
+ *
+ * Example usage:
+ * SHTSensorT<SHT4x> sht;
+ * SHTSensorT<SHT3x, 0x45, SHTSensor::SHT_ACCURACY_MEDIUM> shtAlt;
+ */
+template <class Model, uint8_t I2cAddress, SHTSensor::SHTAccuracy Accuracy,
+          class Bus>
+class SHTSensorT
+{
+public:
+  /** Instantiate a sensor on the default bus, see SHTI2cBus::getDefault() */
+  SHTSensorT()
+      : mBus(Bus::getDefault()),
+        mRawTemperature(0),
+        mRawHumidity(0),
+        mHasSample(false)
+  {
+  }
+
+  /** Instantiate a sensor on the i2c `bus' */
+  SHTSensorT(Bus &bus)
+      : mBus(&bus),
+        mRawTemperature(0),
+        mRawHumidity(0),
+        mHasSample(false)
+  {
+  }
+
+  /**
+   * Read new values from the sensor
+   * After the call, use getTemperature() and getHumidity() to retrieve the
+   * values
+   * Returns true if the sample was read and the values are cached
+   */
+  bool readSample() {
+    uint8_t cmd[Model::COMMAND_SIZE];
+    uint8_t data[6];
+
+    cmd[0] = COMMAND >> 8;
+    if (Model::COMMAND_SIZE > 1) {
+      cmd[Model::COMMAND_SIZE - 1] = COMMAND & 0xff;
+    }
+
+    if (!mBus || !mBus->write(I2cAddress, cmd, Model::COMMAND_SIZE)) {
+      return false;
+    }
+    SHTClock &clock = SHTClock::getCurrent();
+    if (DURATION >= 1000) {
+      clock.delay(DURATION / 1000);
+    }
+    clock.delayMicroseconds(DURATION % 1000);
+    if (!mBus->read(I2cAddress, data, sizeof(data))) {
+      return false;
+    }
+    if (SHTI2cSensor::crc8(&data[0], 2) != data[2] ||
+        SHTI2cSensor::crc8(&data[3], 2) != data[5]) {
+      return false;
+    }
+    mRawTemperature = (data[0] << 8) + data[1];
+    mRawHumidity = (data[3] << 8) + data[4];
+    mHasSample = true;
+    return true;
+  }
+
+  /**
+   * Get the relative humidity in percent read from the last sample
+   * Use readSample() to trigger a new sensor reading
+   */
+  float getHumidity() const {
+    if (!mHasSample) {
+      return SHTSensor::HUMIDITY_INVALID;
+    }
+    return Model::X + mRawHumidity * HUMIDITY_SCALE;
+  }
+
+  /**
+   * Get the temperature in Celsius read from the last sample
+   * Use readSample() to trigger a new sensor reading
+   */
+  float getTemperature() const {
+    if (!mHasSample) {
+      return SHTSensor::TEMPERATURE_INVALID;
+    }
+    return Model::A + mRawTemperature * TEMPERATURE_SCALE;
+  }
+
+  /** See SHTSensor::getHumidityCentiPercent() */
+  int32_t getHumidityCentiPercent() const {
+    if (!mHasSample) {
+      return SHTSensor::FIXED_POINT_INVALID;
+    }
+    return SHTI2cSensor::fixedPointOffset(Model::X) +
+        SHTI2cSensor::fixedPointScale(HUMIDITY_FACTOR, mRawHumidity);
+  }
+
+  /** See SHTSensor::getTemperatureCentiCelsius() */
+  int32_t getTemperatureCentiCelsius() const {
+    if (!mHasSample) {
+      return SHTSensor::FIXED_POINT_INVALID;
+    }
+    return SHTI2cSensor::fixedPointOffset(Model::A) +
+        SHTI2cSensor::fixedPointScale(TEMPERATURE_FACTOR, mRawTemperature);
+  }
+
+private:
+  static constexpr uint16_t COMMAND = Model::command(Accuracy);
+  static constexpr uint16_t DURATION = Model::duration(Accuracy);
+  static constexpr float TEMPERATURE_SCALE = Model::B / Model::C;
+  static constexpr float HUMIDITY_SCALE = Model::Y / Model::Z;
+  static constexpr uint32_t TEMPERATURE_FACTOR =
+      SHTI2cSensor::fixedPointFactor(Model::B, Model::C);
+  static constexpr uint32_t HUMIDITY_FACTOR =
+      SHTI2cSensor::fixedPointFactor(Model::Y, Model::Z);
+
+  Bus *mBus;
+  uint16_t mRawTemperature;
+  uint16_t mRawHumidity;
+  bool mHasSample;
+};
+
+#ifdef ARDUINO
+class SHT3xAnalogSensor
+{
+public:
+
+  /**
+   * Instantiate a new Sensirion SHT3x Analog sensor driver instance.
+   * The required paramters are `humidityPin` and `temperaturePin`
+   * An optional `readResolutionBits' can be set since the Arduino/Genuino Zero
+   * support 12bit precision analog readings. By default, 10 bit precision is
+   * used.
+   *
+   * Example usage:
+   * SHT3xAnalogSensor sht3xAnalog(HUMIDITY_PIN, TEMPERATURE_PIN);
+   * float humidity = sht.readHumidity();
+   * float temperature = sht.readTemperature();
+   */
+  SHT3xAnalogSensor(uint8_t humidityPin, uint8_t temperaturePin,
+                    uint8_t readResolutionBits = 10)
+      : mHumidityAdcPin(humidityPin), mTemperatureAdcPin(temperaturePin),
+        mReadResolutionBits(readResolutionBits)
+  {
+  }
+
+  virtual ~SHT3xAnalogSensor()
+  {
+  }
+
+  // no heap allocation: only the placement form of operator new is available
+  static void *operator new(size_t, void *where) {
+    return where;
+  }
+  static void operator delete(void *, void *) {
+  }
+  // only referenced by the deleting destructor, never called
+  static void operator delete(void *) {
+  }
+
   float readHumidity();
   float readTemperature();
 
@@ -284,5 +1784,6 @@ public:
   uint8_t mTemperatureAdcPin;
   uint8_t mReadResolutionBits;
 };
+#endif /* ARDUINO */
 
 #endif /* SHTSENSOR_H */
@@ -14,6 +14,11 @@ SHTSensor sht1(SHTSensor::SHT3X);
 // Sensor 2 with address pin pulled to Vdd
 SHTSensor sht2(SHTSensor::SHT3X_ALT);
 
+// Group of both sensors: the measurements are started on both sensors at once,
+// so reading the group only takes the time of a single measurement
+SHTSensor *sensors[] = { &sht1, &sht2 };
+SHTSensorGroup group(sensors, 2);
+
 void setup() {
   // put your setup code here, to run once:
   Wire.begin();
@@ -32,8 +37,11 @@ void setup() {
 
 void loop() {
   // put your main code here, to run repeatedly:
-  // read from first sensor
-  if (sht1.readSample()) {
+  // read from both sensors
+  group.readSample();
+
+  // values of first sensor
+  if (group.isSampleValid(0)) {
     Serial.print("SHT1 :\n");
     Serial.print("  RH: ");
     Serial.print(sht1.getHumidity(), 2);
@@ -42,11 +50,11 @@ void loop() {
     Serial.print(sht1.getTemperature(), 2);
     Serial.print("\n");
   } else {
-    Serial.print("Sensor 1: Error in readSample()\n");
+    Serial.print("Sensor 1: Error reading sample\n");
   }
 
-  // read from second sensor
-  if (sht2.readSample()) {
+  // values of second sensor
+  if (group.isSampleValid(1)) {
     Serial.print("SHT2:\n");
     Serial.print("  RH: ");
     Serial.print(sht2.getHumidity(), 2);
@@ -55,7 +63,7 @@ void loop() {
     Serial.print(sht2.getTemperature(), 2);
     Serial.print("\n");
   } else {
-    Serial.print("Sensor 2: Error in readSample()\n");
+    Serial.print("Sensor 2: Error reading sample\n");
   }
 
   delay(1000);
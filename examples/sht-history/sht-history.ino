@@ -0,0 +1,45 @@
+#include <Wire.h>
+
+#include "SHTSensor.h"
+#include "SHTSampleHistory.h"
+
+// keeps the last 60 samples with their SHTClock::millis() timestamps
+SHTSensorWithHistory<60> sht;
+
+void setup() {
+  // put your setup code here, to run once:
+
+  Wire.begin();
+  Serial.begin(9600);
+  delay(1000); // let serial console settle
+
+  if (sht.init()) {
+      Serial.print("init(): success\n");
+  } else {
+      Serial.print("init(): failed\n");
+  }
+}
+
+void loop() {
+  // put your main code here, to run repeatedly:
+
+  if (!sht.readSample()) {
+      Serial.print("Error in readSample()\n");
+  }
+
+  // average temperature of the last 10 samples, converted only here
+  SHTSampleView lastTen = sht.getHistory().latest(10);
+  if (!lastTen.empty()) {
+      float sum = 0;
+      for (uint16_t i = 0; i < lastTen.size(); ++i) {
+          sum += sht.convertTemperature(lastTen[i].sample.temperature);
+      }
+      Serial.print("T (average of ");
+      Serial.print(lastTen.size());
+      Serial.print("): ");
+      Serial.print(sum / lastTen.size(), 2);
+      Serial.print("\n");
+  }
+
+  delay(1000);
+}
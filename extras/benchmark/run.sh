@@ -0,0 +1,24 @@
+#!/bin/sh
+#
+# Build and run extras/benchmark/sht-benchmark.cpp once per CRC
+# implementation. Results are printed as one JSON object per line, e.g. to
+# be stored and compared between releases.
+#
+# Usage: extras/benchmark/run.sh [iterations]
+#
+# Set CXX to use another compiler and CXXFLAGS to add compiler flags.
+
+set -e
+
+root=$(cd "$(dirname "$0")/../.." && pwd)
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+
+for impl in SHT_CRC8_BITWISE SHT_CRC8_NIBBLE_TABLE SHT_CRC8_BYTE_TABLE; do
+  ${CXX:-g++} -std=gnu++11 -O2 $CXXFLAGS -DSHT_CRC8_IMPL=$impl \
+      -I"$root" -I"$root/extras/sim" \
+      "$root/extras/benchmark/sht-benchmark.cpp" \
+      "$root/extras/sim/SHTSimulatedBus.cpp" "$root/SHTSensor.cpp" \
+      -o "$build/sht-benchmark"
+  "$build/sht-benchmark" "$@"
+done
@@ -0,0 +1,263 @@
+/*
+ * Microbenchmarks of the CPU cost of reading a sample, apart from waiting for
+ * the sensor, against simulated sensors
+ *
+ * For each driver, the stages of SHTSensor::readSample() are measured:
+ *   bus          command write and result read on the simulated bus
+ *   crc8         CRC check of the two words of a result
+ *   decode       CRC check and extraction of the raw values of a result
+ *   centi        fixed point conversion of both values
+ *   float        floating point conversion of both values, as done by
+ *                getTemperature() and getHumidity()
+ *   driver_read  readSample() of the driver alone
+ *   sensor_read  readSample() of SHTSensor, i.e. including the copy of the
+ *                values from the driver
+ * The bus stages include the cost of the device models.
+ *
+ * The crc8_bulk stage runs the CRC over a buffer instead, to compare the
+ * throughput of the CRC implementations apart from the call overhead. It is
+ * reported in nanoseconds per byte rather than cycles per byte, which would
+ * need a cycle counter specific to the host; multiply by the clock frequency
+ * in GHz for an estimate of the cycles.
+ *
+ * Every stage prints one JSON object per line with its time and heap
+ * allocations per operation. The CRC implementation is chosen at compile
+ * time; extras/benchmark/run.sh builds and runs all of them.
+ *
+ * Build from the root of the library (glibc is needed to count allocations):
+ *   g++ -std=gnu++11 -O2 -I. -Iextras/sim extras/benchmark/sht-benchmark.cpp \
+ *       extras/sim/SHTSimulatedBus.cpp SHTSensor.cpp -o sht-benchmark
+ *
+ * Usage: ./sht-benchmark [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "SHTSensor.h"
+#include "SHTSimulatedBus.h"
+#include "SHTVirtualClock.h"
+
+//
+// allocation counting
+//
+
+static unsigned long allocations = 0;
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+  ++allocations;
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+  ++allocations;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+  ++allocations;
+  return __libc_realloc(pointer, size);
+}
+
+
+//
+// benchmark harness
+//
+
+#if SHT_CRC8_IMPL == SHT_CRC8_NIBBLE_TABLE
+static const char CRC8_IMPL[] = "nibble_table";
+#elif SHT_CRC8_IMPL == SHT_CRC8_BYTE_TABLE
+static const char CRC8_IMPL[] = "byte_table";
+#else
+static const char CRC8_IMPL[] = "bitwise";
+#endif
+
+// keeps the compiler from dropping the measured work
+static volatile uint32_t sink;
+static volatile float floatSink;
+
+static SHTVirtualClock virtualClock;
+
+static double seconds()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/** Exposes the CRC check of the drivers */
+class CrcAccess : public SHTI2cSensor
+{
+public:
+  using SHTI2cSensor::crc8;
+};
+
+/** Fixed inputs for the stages of one driver */
+struct DriverSetup {
+  const char *name;
+  SHTI2cSensor *driver;
+  SHTSensor *sensor;
+  uint8_t i2cAddress;
+  uint8_t command[2];
+  uint8_t commandLength;
+  /** Conversion time the simulated device needs, in milliseconds */
+  uint8_t conversionTime;
+};
+
+static void report(const char *stage, const char *driver,
+                   unsigned long iterations, double elapsed,
+                   unsigned long allocated, unsigned long failures)
+{
+  printf("{\"stage\": \"%s\", \"driver\": \"%s\", \"crc8\": \"%s\", "
+         "\"iterations\": %lu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, "
+         "\"failures\": %lu}\n",
+         stage, driver, CRC8_IMPL, iterations, elapsed * 1e9 / iterations,
+         (double)allocated / iterations, failures);
+}
+
+static void reportBulk(const char *stage, unsigned long bytes, double elapsed)
+{
+  printf("{\"stage\": \"%s\", \"crc8\": \"%s\", \"bytes\": %lu, "
+         "\"ns_per_byte\": %.3f}\n",
+         stage, CRC8_IMPL, bytes, elapsed * 1e9 / bytes);
+}
+
+// runs `body' `iterations' times and reports it as `stage' of `driver'
+#define BENCHMARK(stage, driver, iterations, body)                          \
+  do {                                                                      \
+    unsigned long failures = 0;                                             \
+    unsigned long allocated = allocations;                                  \
+    double start = seconds();                                               \
+    for (unsigned long i = 0; i < (iterations); ++i) {                      \
+      body;                                                                 \
+    }                                                                       \
+    double elapsed = seconds() - start;                                     \
+    report(stage, driver, iterations, elapsed, allocations - allocated,     \
+           failures);                                                       \
+  } while (0)
+
+static void runDriver(SHTSimulatedBus &bus, const DriverSetup &setup,
+                      unsigned long iterations)
+{
+  uint8_t data[SHTI2cSensor::EXPECTED_DATA_SIZE];
+
+  BENCHMARK("bus", setup.name, iterations, {
+    if (!bus.write(setup.i2cAddress, setup.command, setup.commandLength)) {
+      ++failures;
+    }
+    virtualClock.delay(setup.conversionTime);
+    if (!bus.read(setup.i2cAddress, data, sizeof(data))) {
+      ++failures;
+    }
+  });
+
+  uint8_t words[SHTI2cSensor::EXPECTED_DATA_SIZE];
+  memcpy(words, data, sizeof(words));
+  BENCHMARK("crc8", setup.name, iterations, {
+    words[1] = (uint8_t)i;
+    sink = CrcAccess::crc8(&words[0], 2) + CrcAccess::crc8(&words[3], 2);
+  });
+
+  // a valid result, as left in `data' by the bus stage
+  SHTI2cBus::ReadTransfer transfer;
+  transfer.i2cAddress = setup.i2cAddress;
+  transfer.data = data;
+  transfer.length = sizeof(data);
+  transfer.success = true;
+  BENCHMARK("decode", setup.name, iterations, {
+    if (!setup.driver->completeFetch(transfer)) {
+      ++failures;
+    }
+  });
+
+  BENCHMARK("centi", setup.name, iterations, {
+    sink = setup.driver->convertTemperatureCentiCelsius((uint16_t)i) +
+        setup.driver->convertHumidityCentiPercent((uint16_t)i);
+  });
+
+  BENCHMARK("float", setup.name, iterations, {
+    floatSink = setup.driver->convertTemperature((uint16_t)i) +
+        setup.driver->convertHumidity((uint16_t)i);
+  });
+
+  BENCHMARK("driver_read", setup.name, iterations, {
+    if (!setup.driver->readSample()) {
+      ++failures;
+    }
+  });
+
+  BENCHMARK("sensor_read", setup.name, iterations, {
+    if (!setup.sensor->readSample()) {
+      ++failures;
+    }
+  });
+}
+
+/** Runs the CRC over a buffer of the largest length crc8() accepts */
+static void runBulkCrc(unsigned long iterations)
+{
+  uint8_t buffer[255];
+  for (unsigned int i = 0; i < sizeof(buffer); ++i) {
+    buffer[i] = (uint8_t)(i * 167 + 13);
+  }
+
+  double start = seconds();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    buffer[0] = (uint8_t)i;
+    sink = CrcAccess::crc8(buffer, sizeof(buffer));
+  }
+  double elapsed = seconds() - start;
+  reportBulk("crc8_bulk", iterations * sizeof(buffer), elapsed);
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long iterations = argc > 1 ? atol(argv[1]) : 200000;
+  if (iterations < 1) {
+    fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  SHTClock::setCurrent(&virtualClock);
+
+  SHTSimulatedBus bus;
+  SHT3xSimulatedDevice sht3xDevice(0x44);
+  SHT4xSimulatedDevice sht4xDevice(0x45);
+  SHTC1SimulatedDevice shtc1Device;
+  bus.attach(sht3xDevice);
+  bus.attach(sht4xDevice);
+  bus.attach(shtc1Device);
+
+  SHT3xSensor sht3xDriver(bus, 0x44);
+  SHT4xSensor sht4xDriver(bus, 0x45);
+  SHTC1Sensor shtc1Driver(bus);
+  SHTSensor sht3x(bus, SHTSensor::SHT3X, 0x44);
+  SHTSensor sht4x(bus, SHTSensor::SHT4X, 0x45);
+  SHTSensor shtc1(bus, SHTSensor::SHTC1);
+  if (!sht3x.init() || !sht4x.init() || !shtc1.init()) {
+    fprintf(stderr, "init() failed\n");
+    return 1;
+  }
+
+  const DriverSetup setups[] = {
+    { "SHT3x", &sht3xDriver, &sht3x, 0x44, { 0x24, 0x00 }, 2, 15 },
+    { "SHT4x", &sht4xDriver, &sht4x, 0x45, { 0xFD, 0x00 }, 1, 10 },
+    { "SHTC1", &shtc1Driver, &shtc1, 0x70, { 0x78, 0x66 }, 2, 15 }
+  };
+  for (unsigned int i = 0; i < sizeof(setups) / sizeof(setups[0]); ++i) {
+    runDriver(bus, setups[i], iterations);
+  }
+  runBulkCrc(iterations / 10);
+
+  SHTClock::setCurrent(NULL);
+  return 0;
+}
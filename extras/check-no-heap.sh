@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# Check that the compiled library never references heap allocation.
+#
+# Usage: extras/check-no-heap.sh <object file>...
+#   e.g. extras/check-no-heap.sh /tmp/arduino-build/libraries/arduino-sht/SHTSensor.cpp.o
+#
+# Set NM to the nm of your toolchain when checking cross-compiled objects,
+# e.g. NM=avr-nm. Exits with a non-zero status if malloc/calloc/realloc/free
+# or any form of operator new, new[], delete or delete[] is referenced: on AVR,
+# even an unused operator delete links the malloc module of avr-libc.
+
+NM=${NM:-nm}
+
+if [ $# -eq 0 ]; then
+  echo "usage: $0 <object file>..." >&2
+  exit 2
+fi
+
+status=0
+for obj in "$@"; do
+  # _Znw*/_Zna* are the mangled names of operator new and operator new[],
+  # _Zdl*/_Zda* those of operator delete and operator delete[]
+  found=$("$NM" -u "$obj" | awk '{ print $NF }' |
+          grep -E '^_?(malloc|calloc|realloc|free|_Znw[jm].*|_Zna[jm].*|_Zdl.*|_Zda.*)$')
+  if [ -n "$found" ]; then
+    echo "$obj references heap allocation:" >&2
+    echo "$found" | sed 's/^/  /' >&2
+    status=1
+  fi
+done
+
+exit $status
@@ -0,0 +1,148 @@
+/*
+ * Compare the transfers and wall time of SHTSensorGroup rounds with and
+ * without batching the reads of the group into one I2C_RDWR transaction
+ *
+ * No sensor is needed: the bus answers every read with a valid sample, but
+ * still issues one real system call (an ioctl on /dev/null) per transaction
+ * to account for the cost of entering the kernel.
+ *
+ * Build from the root of the library:
+ *   g++ -std=gnu++11 -O2 -I. extras/linux/group-batch-benchmark.cpp \
+ *       SHTSensor.cpp SHTLinuxI2cBus.cpp -o group-batch-benchmark
+ *
+ * Usage: ./group-batch-benchmark [sensors [rounds]]
+ */
+
+#include <fcntl.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "SHTSensor.h"
+#include "SHTLinuxI2cBus.h"
+
+static uint8_t crc8(const uint8_t *data, uint8_t len)
+{
+  uint8_t crc = 0xff;
+  for (uint8_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+class SimulatedLinuxBus : public SHTLinuxI2cBus
+{
+public:
+  SimulatedLinuxBus()
+      : SHTLinuxI2cBus("/dev/null"), mTransfers(0)
+  {
+    mNull = open("/dev/null", O_RDWR);
+  }
+
+  virtual ~SimulatedLinuxBus()
+  {
+    close(mNull);
+  }
+
+  unsigned long mTransfers;
+
+protected:
+  virtual bool transfer(struct i2c_msg *messages, uint32_t count)
+  {
+    struct i2c_rdwr_ioctl_data transaction;
+    transaction.msgs = messages;
+    transaction.nmsgs = count;
+    ioctl(mNull, I2C_RDWR, &transaction); // fails, but enters the kernel
+    ++mTransfers;
+
+    for (uint32_t i = 0; i < count; ++i) {
+      if (!(messages[i].flags & I2C_M_RD)) {
+        continue;
+      }
+      for (uint16_t j = 0; j + 3 <= messages[i].len; j += 3) {
+        messages[i].buf[j] = 0x66;
+        messages[i].buf[j + 1] = (uint8_t)messages[i].addr;
+        messages[i].buf[j + 2] = crc8(&messages[i].buf[j], 2);
+      }
+    }
+    return true;
+  }
+
+private:
+  int mNull;
+};
+
+/** Reads each sensor of a batch with its own transaction */
+class UnbatchedLinuxBus : public SimulatedLinuxBus
+{
+public:
+  virtual uint8_t readBatch(ReadTransfer *transfers, uint8_t count)
+  {
+    return SHTI2cBus::readBatch(transfers, count);
+  }
+};
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(const char *name, SimulatedLinuxBus &bus, uint8_t count,
+                unsigned long rounds)
+{
+  static SHTSensor sensors[SHTSensorGroup::MAX_SENSORS];
+  SHTSensor *members[SHTSensorGroup::MAX_SENSORS];
+  for (uint8_t i = 0; i < count; ++i) {
+    sensors[i].~SHTSensor();
+    new (&sensors[i]) SHTSensor(bus, SHTSensor::SHT3X, 0x40 + i);
+    members[i] = &sensors[i];
+    // periodic results can be fetched right away, leaving only the bus cost
+    if (!sensors[i].init() ||
+        !sensors[i].startPeriodicMeasurement(SHTSensor::SHT_PERIODIC_10_MPS)) {
+      fprintf(stderr, "%s: sensor %u setup failed\n", name, i);
+      exit(1);
+    }
+  }
+  SHTSensorGroup group(members, count);
+
+  bus.mTransfers = 0;
+  unsigned long failures = 0;
+  double start = now();
+  for (unsigned long r = 0; r < rounds; ++r) {
+    if (!group.readSample()) {
+      ++failures;
+    }
+  }
+  double elapsed = now() - start;
+
+  printf("%-9s sensors=%u transfers/round=%.2f us/round=%.2f failures=%lu\n",
+         name, count, (double)bus.mTransfers / rounds, elapsed * 1e6 / rounds,
+         failures);
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned count = argc > 1 ? atoi(argv[1]) : 3;
+  unsigned long rounds = argc > 2 ? atol(argv[2]) : 20000;
+  if (count < 1 || count > SHTSensorGroup::MAX_SENSORS || rounds < 1) {
+    fprintf(stderr, "usage: %s [sensors (1-%u) [rounds]]\n", argv[0],
+            SHTSensorGroup::MAX_SENSORS);
+    return 1;
+  }
+
+  UnbatchedLinuxBus unbatched;
+  SimulatedLinuxBus batched;
+  run("unbatched", unbatched, count, rounds);
+  run("batched", batched, count, rounds);
+  return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Read an SHT Sensor on a Linux i2c-dev bus
+ *
+ * Build from the root of the library:
+ *   g++ -std=gnu++11 -O2 -I. extras/linux/sht-linux.cpp SHTSensor.cpp \
+ *       SHTLinuxI2cBus.cpp -o sht-linux
+ *
+ * Usage: ./sht-linux [device], e.g. ./sht-linux /dev/i2c-1
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "SHTSensor.h"
+#include "SHTLinuxI2cBus.h"
+
+int main(int argc, char *argv[])
+{
+  SHTLinuxI2cBus bus(argc > 1 ? argv[1] : "/dev/i2c-1");
+  SHTSensor sht(bus);
+
+  if (!bus.begin()) {
+    perror("open");
+    return 1;
+  }
+  if (!sht.init()) {
+    fprintf(stderr, "init(): failed\n");
+    return 1;
+  }
+
+  for (;;) {
+    if (sht.readSample()) {
+      printf("RH: %.2f  T: %.2f\n", sht.getHumidity(), sht.getTemperature());
+    } else {
+      printf("Error in readSample()\n");
+    }
+    sleep(1);
+  }
+}
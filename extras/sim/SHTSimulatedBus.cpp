@@ -0,0 +1,447 @@
+/*
+ *  Copyright (c) 2018, Sensirion AG
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *      * Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright
+ *        notice, this list of conditions and the following disclaimer in the
+ *        documentation and/or other materials provided with the distribution.
+ *      * Neither the name of the Sensirion AG nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARDUINO
+
+#include <math.h>
+
+#include "SHTSimulatedBus.h"
+
+static unsigned long nowMicros()
+{
+  return SHTClock::getCurrent().micros();
+}
+
+
+//
+// class SHTSimulatedWaveform
+//
+
+float SHTSimulatedWaveform::at(float seconds) const
+{
+  if (mFunction) {
+    return mFunction(seconds);
+  }
+  if (mPeriod <= 0) {
+    return mOffset;
+  }
+  return mOffset + mAmplitude * sinf(2 * (float)M_PI * seconds / mPeriod);
+}
+
+
+//
+// class SHTSimulatedDevice
+//
+
+SHTSimulatedDevice::SHTSimulatedDevice(uint8_t i2cAddress,
+                                       float temperatureOffset,
+                                       float temperatureScale,
+                                       float humidityOffset,
+                                       float humidityScale)
+    : mMeasurements(0),
+      mI2cAddress(i2cAddress),
+      mTemperatureOffset(temperatureOffset),
+      mTemperatureScale(temperatureScale),
+      mHumidityOffset(humidityOffset),
+      mHumidityScale(humidityScale),
+      mTemperature(25),
+      mHumidity(50),
+      mConversionTimePercent(100),
+      mReplyLength(0),
+      mReplyReadyAt(0),
+      mClockStretching(false)
+{
+}
+
+bool SHTSimulatedDevice::write(const uint8_t *data, uint8_t length,
+                               unsigned long now)
+{
+  if (isBusy(now)) {
+    return false;
+  }
+  if (length == 0) {
+    // address probe
+    return true;
+  }
+  // a new command discards the result of the previous one
+  clearReply();
+  return handleCommand(data, length, now);
+}
+
+bool SHTSimulatedDevice::read(uint8_t *data, uint8_t length,
+                              unsigned long now)
+{
+  if (mClockStretching && isBusy(now)) {
+    // hold the clock line until the result is ready
+    SHTClock::getCurrent().delayMicroseconds(mReplyReadyAt - now);
+    now = mReplyReadyAt;
+  }
+  if (isBusy(now) || mReplyLength == 0) {
+    return false;
+  }
+  for (uint8_t i = 0; i < length; ++i) {
+    // the bus reads 0xff once the device stops driving it
+    data[i] = i < mReplyLength ? mReply[i] : 0xff;
+  }
+  clearReply();
+  return true;
+}
+
+bool SHTSimulatedDevice::isBusy(unsigned long now) const
+{
+  return mReplyLength > 0 && (long)(now - mReplyReadyAt) < 0;
+}
+
+void SHTSimulatedDevice::startMeasurement(unsigned long now,
+                                          unsigned long conversionTime,
+                                          bool humidityFirst,
+                                          bool clockStretching)
+{
+  uint16_t words[2];
+  words[humidityFirst ? 1 : 0] = getTemperatureTicks(now);
+  words[humidityFirst ? 0 : 1] = getHumidityTicks(now);
+  setReply(words, 2, now + scaleConversionTime(conversionTime));
+  mClockStretching = clockStretching;
+  ++mMeasurements;
+}
+
+void SHTSimulatedDevice::setReply(const uint16_t *words, uint8_t count,
+                                  unsigned long readyAt)
+{
+  if (count > MAX_REPLY_WORDS) {
+    count = MAX_REPLY_WORDS;
+  }
+  for (uint8_t i = 0; i < count; ++i) {
+    mReply[i * 3] = words[i] >> 8;
+    mReply[i * 3 + 1] = words[i] & 0xff;
+    mReply[i * 3 + 2] = crc8(&mReply[i * 3], 2);
+  }
+  mReplyLength = count * 3;
+  mReplyReadyAt = readyAt;
+}
+
+uint16_t SHTSimulatedDevice::getTemperatureTicks(unsigned long now) const
+{
+  return toTicks(mTemperature.at(now / 1e6), mTemperatureOffset,
+                 mTemperatureScale);
+}
+
+uint16_t SHTSimulatedDevice::getHumidityTicks(unsigned long now) const
+{
+  return toTicks(mHumidity.at(now / 1e6), mHumidityOffset, mHumidityScale);
+}
+
+uint16_t SHTSimulatedDevice::toTicks(float value, float offset, float scale)
+{
+  float ticks = (value - offset) * 65535 / scale + 0.5f;
+  if (ticks <= 0) {
+    return 0;
+  }
+  if (ticks >= 65535) {
+    return 65535;
+  }
+  return (uint16_t)ticks;
+}
+
+uint8_t SHTSimulatedDevice::crc8(const uint8_t *data, uint8_t length)
+{
+  // CRC-8, polynomial 0x31, initialization 0xff, as used by the sensors
+  uint8_t crc = 0xff;
+  for (uint8_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+
+//
+// class SHT3xSimulatedDevice
+//
+
+// periodic mode commands with their period and conversion time
+static const struct {
+  uint16_t command;
+  unsigned long period;
+  unsigned long conversionTime;
+} SHT3X_PERIODIC_MODES[] = {
+  { 0x2032, 2000000, 15000 }, { 0x2024, 2000000, 6000 },
+  { 0x202F, 2000000, 4000 },  { 0x2130, 1000000, 15000 },
+  { 0x2126, 1000000, 6000 },  { 0x212D, 1000000, 4000 },
+  { 0x2236, 500000, 15000 },  { 0x2220, 500000, 6000 },
+  { 0x222B, 500000, 4000 },   { 0x2334, 250000, 15000 },
+  { 0x2322, 250000, 6000 },   { 0x2329, 250000, 4000 },
+  { 0x2737, 100000, 15000 },  { 0x2721, 100000, 6000 },
+  { 0x272A, 100000, 4000 }
+};
+
+bool SHT3xSimulatedDevice::handleCommand(const uint8_t *command,
+                                         uint8_t length, unsigned long now)
+{
+  if (length != 2) {
+    // incomplete commands are acknowledged but ignored
+    return true;
+  }
+  uint16_t cmd = (command[0] << 8) | command[1];
+
+  if (mPeriodic) {
+    // only fetch, break and reset are accepted in periodic mode
+    switch (cmd) {
+      case 0xE000:
+        return fetchPeriodicResult(now);
+      case 0x3093:
+      case 0x30A2:
+        mPeriodic = false;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  switch (cmd) {
+    case 0x2400:
+      startMeasurement(now, 15000, false);
+      return true;
+    case 0x240B:
+      startMeasurement(now, 6000, false);
+      return true;
+    case 0x2416:
+      startMeasurement(now, 4000, false);
+      return true;
+    case 0x2C06:
+      startMeasurement(now, 15000, false, true);
+      return true;
+    case 0x2C0D:
+      startMeasurement(now, 6000, false, true);
+      return true;
+    case 0x2C10:
+      startMeasurement(now, 4000, false, true);
+      return true;
+    case 0xF32D:
+      setReply(&mStatus, 1, now);
+      return true;
+    case 0x3041:
+      // clear status
+      mStatus = 0;
+      return true;
+    case 0xE000:
+    case 0x3093:
+    case 0x30A2:
+      return true;
+  }
+
+  for (unsigned int i = 0;
+       i < sizeof(SHT3X_PERIODIC_MODES) / sizeof(SHT3X_PERIODIC_MODES[0]);
+       ++i) {
+    if (SHT3X_PERIODIC_MODES[i].command == cmd) {
+      mPeriodic = true;
+      mPeriod = SHT3X_PERIODIC_MODES[i].period;
+      mConversionTime =
+          scaleConversionTime(SHT3X_PERIODIC_MODES[i].conversionTime);
+      mPeriodicStart = now;
+      mFetched = 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SHT3xSimulatedDevice::fetchPeriodicResult(unsigned long now)
+{
+  unsigned long elapsed = now - mPeriodicStart;
+  if (elapsed < mConversionTime) {
+    // no result yet, the following read is not acknowledged
+    return true;
+  }
+  unsigned long completed = (elapsed - mConversionTime) / mPeriod + 1;
+  if (completed > mFetched) {
+    unsigned long measured = mPeriodicStart + (completed - 1) * mPeriod;
+    uint16_t words[2] = { getTemperatureTicks(measured),
+                          getHumidityTicks(measured) };
+    setReply(words, 2, now);
+    mFetched = completed;
+    ++mMeasurements;
+  }
+  return true;
+}
+
+
+//
+// class SHT4xSimulatedDevice
+//
+
+bool SHT4xSimulatedDevice::handleCommand(const uint8_t *command,
+                                         uint8_t length, unsigned long now)
+{
+  if (length != 1) {
+    return false;
+  }
+  switch (command[0]) {
+    case 0xFD:
+      startMeasurement(now, 8300, false);
+      return true;
+    case 0xF6:
+      startMeasurement(now, 4500, false);
+      return true;
+    case 0xE0:
+      startMeasurement(now, 1700, false);
+      return true;
+    case 0x89:
+    {
+      uint16_t words[2] = { (uint16_t)(mSerialNumber >> 16),
+                            (uint16_t)(mSerialNumber & 0xffff) };
+      setReply(words, 2, now);
+      return true;
+    }
+    case 0x94:
+      // soft reset
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+//
+// class SHTC1SimulatedDevice
+//
+
+bool SHTC1SimulatedDevice::handleCommand(const uint8_t *command,
+                                         uint8_t length, unsigned long now)
+{
+  if (length != 2) {
+    return false;
+  }
+  uint16_t cmd = (command[0] << 8) | command[1];
+  bool isShtc3 = mId & 0x0800;
+
+  if (mSleeping) {
+    // only the wakeup command is accepted in sleep mode
+    if (cmd != 0x3517) {
+      return false;
+    }
+    mSleeping = false;
+    mAwakeAt = now + 240;
+    return true;
+  }
+  if ((long)(now - mAwakeAt) < 0) {
+    // still waking up
+    return false;
+  }
+
+  // the SHTC3 converts faster than the SHTC1 in normal mode
+  unsigned long conversionTime = isShtc3 ? 12100 : 14400;
+  switch (cmd) {
+    case 0x7866:
+      startMeasurement(now, conversionTime, false);
+      return true;
+    case 0x58E0:
+      startMeasurement(now, conversionTime, true);
+      return true;
+    case 0x7CA2:
+      startMeasurement(now, conversionTime, false, true);
+      return true;
+    case 0x5C24:
+      startMeasurement(now, conversionTime, true, true);
+      return true;
+    case 0x609C:
+    case 0x401A:
+    case 0x6458:
+    case 0x44DE:
+      // low power mode, SHTC3 only
+      if (!isShtc3) {
+        return false;
+      }
+      startMeasurement(now, 800, cmd == 0x401A || cmd == 0x44DE,
+                       cmd == 0x6458 || cmd == 0x44DE);
+      return true;
+    case 0xEFC8:
+      setReply(&mId, 1, now);
+      return true;
+    case 0x805D:
+      // soft reset
+      return true;
+    case 0xB098:
+      mSleeping = isShtc3;
+      return isShtc3;
+    case 0x3517:
+      return isShtc3;
+    default:
+      return false;
+  }
+}
+
+
+//
+// class SHTSimulatedBus
+//
+
+bool SHTSimulatedBus::attach(SHTSimulatedDevice &device)
+{
+  if (mDeviceCount >= MAX_DEVICES || find(device.getI2cAddress())) {
+    return false;
+  }
+  mDevices[mDeviceCount++] = &device;
+  return true;
+}
+
+bool SHTSimulatedBus::write(uint8_t i2cAddress, const uint8_t *data,
+                            uint8_t length)
+{
+  ++mWrites;
+  SHTSimulatedDevice *device = find(i2cAddress);
+  if (!device || !device->write(data, length, nowMicros())) {
+    ++mNacks;
+    return false;
+  }
+  return true;
+}
+
+bool SHTSimulatedBus::read(uint8_t i2cAddress, uint8_t *data, uint8_t length)
+{
+  ++mReads;
+  SHTSimulatedDevice *device = find(i2cAddress);
+  if (!device || !device->read(data, length, nowMicros())) {
+    ++mNacks;
+    return false;
+  }
+  return true;
+}
+
+SHTSimulatedDevice *SHTSimulatedBus::find(uint8_t i2cAddress)
+{
+  for (uint8_t i = 0; i < mDeviceCount; ++i) {
+    if (mDevices[i]->getI2cAddress() == i2cAddress) {
+      return mDevices[i];
+    }
+  }
+  return NULL;
+}
+
+#endif /* ARDUINO */
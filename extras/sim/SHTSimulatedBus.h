@@ -0,0 +1,315 @@
+/*
+ *  Copyright (c) 2018, Sensirion AG
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *      * Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright
+ *        notice, this list of conditions and the following disclaimer in the
+ *        documentation and/or other materials provided with the distribution.
+ *      * Neither the name of the Sensirion AG nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SHTSIMULATEDBUS_H
+#define SHTSIMULATEDBUS_H
+
+#ifndef ARDUINO
+
+#include <inttypes.h>
+
+#include "SHTSensor.h"
+
+/**
+ * Value of a simulated quantity over time: either constant, a sine wave
+ * `offset' + `amplitude' * sin(2 * pi * t / `period') with t and `period' in
+ * seconds, or given by a function of t.
+ */
+class SHTSimulatedWaveform
+{
+public:
+  SHTSimulatedWaveform(float value)
+      : mOffset(value), mAmplitude(0), mPeriod(0), mFunction(NULL)
+  {
+  }
+
+  SHTSimulatedWaveform(float offset, float amplitude, float period)
+      : mOffset(offset), mAmplitude(amplitude), mPeriod(period),
+        mFunction(NULL)
+  {
+  }
+
+  SHTSimulatedWaveform(float (*function)(float seconds))
+      : mOffset(0), mAmplitude(0), mPeriod(0), mFunction(function)
+  {
+  }
+
+  /** Get the value at `seconds' */
+  float at(float seconds) const;
+
+private:
+  float mOffset;
+  float mAmplitude;
+  float mPeriod;
+  float (*mFunction)(float seconds);
+};
+
+/**
+ * Behavioral model of a digital SHT Sensor on a SHTSimulatedBus
+ *
+ * Devices answer the command codes of the real sensors with words protected
+ * by the sensor CRC. A measurement takes the conversion time given in the
+ * data sheet; reading it earlier, reading without a pending result or sending
+ * an unknown command is not acknowledged (NACK). With the clock stretching
+ * commands, reading early waits on the current SHTClock until the result is
+ * ready instead.
+ */
+class SHTSimulatedDevice
+{
+public:
+  virtual ~SHTSimulatedDevice()
+  {
+  }
+
+  uint8_t getI2cAddress() const {
+    return mI2cAddress;
+  }
+
+  /** Set the temperature in degrees Celsius seen by the sensor */
+  void setTemperature(const SHTSimulatedWaveform &temperature) {
+    mTemperature = temperature;
+  }
+
+  /** Set the relative humidity in percent seen by the sensor */
+  void setHumidity(const SHTSimulatedWaveform &humidity) {
+    mHumidity = humidity;
+  }
+
+  /**
+   * Scale the conversion times of the data sheet by `percent', e.g. 80 to
+   * simulate a sensor finishing early
+   */
+  void setConversionTimePercent(uint16_t percent) {
+    mConversionTimePercent = percent;
+  }
+
+  /**
+   * Handle a write of `length' bytes at `now', the SHTClock::micros() time
+   * Returns false if the write is not acknowledged (NACK)
+   */
+  bool write(const uint8_t *data, uint8_t length, unsigned long now);
+
+  /**
+   * Handle a read of `length' bytes at `now', the SHTClock::micros() time
+   * Returns false if the read is not acknowledged (NACK)
+   */
+  bool read(uint8_t *data, uint8_t length, unsigned long now);
+
+  /** Number of single shot measurements started and periodic results fetched */
+  unsigned long mMeasurements;
+
+protected:
+  /**
+   * Instantiate a device at `i2cAddress' converting values to ticks with the
+   * inverse of value = offset + scale * (ticks / 65535)
+   */
+  SHTSimulatedDevice(uint8_t i2cAddress, float temperatureOffset,
+                     float temperatureScale, float humidityOffset,
+                     float humidityScale);
+
+  /**
+   * Handle the `length' bytes of a command written at `now'
+   * Returns false if the command is not acknowledged
+   */
+  virtual bool handleCommand(const uint8_t *command, uint8_t length,
+                             unsigned long now) = 0;
+
+  /**
+   * Returns true while the device does not acknowledge its address, i.e. while
+   * a measurement is running
+   */
+  bool isBusy(unsigned long now) const;
+
+  /**
+   * Start a measurement at `now' whose result is ready after `conversionTime'
+   * microseconds as given in the data sheet
+   */
+  void startMeasurement(unsigned long now, unsigned long conversionTime,
+                        bool humidityFirst, bool clockStretching = false);
+
+  /** Make `count' words readable from `readyAt' on */
+  void setReply(const uint16_t *words, uint8_t count, unsigned long readyAt);
+
+  /** Drop any result that was not read yet */
+  void clearReply() {
+    mReplyLength = 0;
+    mClockStretching = false;
+  }
+
+  unsigned long scaleConversionTime(unsigned long conversionTime) const {
+    return conversionTime * mConversionTimePercent / 100;
+  }
+
+  uint16_t getTemperatureTicks(unsigned long now) const;
+  uint16_t getHumidityTicks(unsigned long now) const;
+
+  static uint8_t crc8(const uint8_t *data, uint8_t length);
+
+  static const uint8_t MAX_REPLY_WORDS = 2;
+
+private:
+  static uint16_t toTicks(float value, float offset, float scale);
+
+  uint8_t mI2cAddress;
+  float mTemperatureOffset;
+  float mTemperatureScale;
+  float mHumidityOffset;
+  float mHumidityScale;
+  SHTSimulatedWaveform mTemperature;
+  SHTSimulatedWaveform mHumidity;
+  uint16_t mConversionTimePercent;
+  uint8_t mReply[MAX_REPLY_WORDS * 3];
+  uint8_t mReplyLength;
+  unsigned long mReplyReadyAt;
+  /** Reads wait for the pending result instead of failing */
+  bool mClockStretching;
+};
+
+/** Simulated SHT3x-DIS: single shot, periodic mode and status register */
+class SHT3xSimulatedDevice : public SHTSimulatedDevice
+{
+public:
+  SHT3xSimulatedDevice(uint8_t i2cAddress = 0x44)
+      : SHTSimulatedDevice(i2cAddress, -45, 175, 0, 100),
+        mStatus(0x8010), mPeriodic(false), mPeriod(0), mConversionTime(0),
+        mPeriodicStart(0), mFetched(0)
+  {
+  }
+
+protected:
+  virtual bool handleCommand(const uint8_t *command, uint8_t length,
+                             unsigned long now);
+
+private:
+  bool fetchPeriodicResult(unsigned long now);
+
+  uint16_t mStatus;
+  bool mPeriodic;
+  /** Time between periodic measurements in microseconds */
+  unsigned long mPeriod;
+  unsigned long mConversionTime;
+  unsigned long mPeriodicStart;
+  /** Number of periodic results fetched */
+  unsigned long mFetched;
+};
+
+/** Simulated SHT4x: single byte commands and serial number */
+class SHT4xSimulatedDevice : public SHTSimulatedDevice
+{
+public:
+  SHT4xSimulatedDevice(uint8_t i2cAddress = 0x44,
+                       uint32_t serialNumber = 0x12345678)
+      : SHTSimulatedDevice(i2cAddress, -45, 175, -6, 125),
+        mSerialNumber(serialNumber)
+  {
+  }
+
+protected:
+  virtual bool handleCommand(const uint8_t *command, uint8_t length,
+                             unsigned long now);
+
+private:
+  uint32_t mSerialNumber;
+};
+
+/**
+ * Simulated SHTC1 family at address 0x70. The `id' register tells the
+ * variants apart, e.g. 0x0007 for the SHTC1 and 0x0887 for the SHTC3. Only
+ * the SHTC3 (bit 11 set) supports the sleep and low power modes.
+ */
+class SHTC1SimulatedDevice : public SHTSimulatedDevice
+{
+public:
+  SHTC1SimulatedDevice(uint16_t id = 0x0007)
+      : SHTSimulatedDevice(0x70, -45, 175, 0, 100),
+        mId(id), mSleeping(false), mAwakeAt(0)
+  {
+  }
+
+  /** Returns true while the sensor is in sleep mode */
+  bool isSleeping() const {
+    return mSleeping;
+  }
+
+protected:
+  virtual bool handleCommand(const uint8_t *command, uint8_t length,
+                             unsigned long now);
+
+private:
+  uint16_t mId;
+  bool mSleeping;
+  /** End of the wakeup time after leaving the sleep mode */
+  unsigned long mAwakeAt;
+};
+
+/**
+ * SHTI2cBus connecting SHTSimulatedDevice instances, for running the library
+ * on a host without sensors, e.g. to test or benchmark it
+ * The devices follow the current SHTClock; with a SHTVirtualClock,
+ * conversion times pass instantly.
+ *
+ * Example usage:
+ * SHTSimulatedBus bus;
+ * SHT3xSimulatedDevice device;
+ * device.setTemperature(SHTSimulatedWaveform(20, 5, 3600));
+ * bus.attach(device);
+ * SHTSensor sht(bus, SHTSensor::SHT3X);
+ */
+class SHTSimulatedBus : public SHTI2cBus
+{
+public:
+  static const uint8_t MAX_DEVICES = 8;
+
+  SHTSimulatedBus()
+      : mWrites(0), mReads(0), mNacks(0), mDeviceCount(0)
+  {
+  }
+
+  /**
+   * Connect `device' to the bus; the device must outlive the bus.
+   * Returns false if the bus is full or the address is in use
+   */
+  bool attach(SHTSimulatedDevice &device);
+
+  virtual bool write(uint8_t i2cAddress, const uint8_t *data, uint8_t length);
+  virtual bool read(uint8_t i2cAddress, uint8_t *data, uint8_t length);
+
+  /** Transfer counters, for checking the bus traffic of the library */
+  unsigned long mWrites;
+  unsigned long mReads;
+  unsigned long mNacks;
+
+private:
+  SHTSimulatedDevice *find(uint8_t i2cAddress);
+
+  SHTSimulatedDevice *mDevices[MAX_DEVICES];
+  uint8_t mDeviceCount;
+};
+
+#endif /* ARDUINO */
+
+#endif /* SHTSIMULATEDBUS_H */
@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2018, Sensirion AG
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *      * Redistributions of source code must retain the above copyright
+ *        notice, this list of conditions and the following disclaimer.
+ *      * Redistributions in binary form must reproduce the above copyright
+ *        notice, this list of conditions and the following disclaimer in the
+ *        documentation and/or other materials provided with the distribution.
+ *      * Neither the name of the Sensirion AG nor the names of its
+ *        contributors may be used to endorse or promote products derived
+ *        from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ *  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ *  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ *  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SHTVIRTUALCLOCK_H
+#define SHTVIRTUALCLOCK_H
+
+#include "SHTSensor.h"
+
+/**
+ * SHTClock whose time only moves when waiting: delay() and
+ * delayMicroseconds() advance the time instantly instead of sleeping.
+ * Simulations using it run as fast as the host allows and are reproducible.
+ *
+ * Example usage:
+ * SHTVirtualClock clock;
+ * SHTClock::setCurrent(&clock);
+ * ... // a day of samples takes milliseconds
+ * SHTClock::setCurrent(NULL);
+ */
+class SHTVirtualClock : public SHTClock
+{
+public:
+  SHTVirtualClock(unsigned long startMicros = 0)
+      : mNow(startMicros)
+  {
+  }
+
+  virtual unsigned long millis() {
+    return (unsigned long)(mNow / 1000);
+  }
+
+  virtual unsigned long micros() {
+    return (unsigned long)mNow;
+  }
+
+  virtual void delay(unsigned long ms) {
+    mNow += ms * 1000;
+  }
+
+  virtual void delayMicroseconds(unsigned int us) {
+    mNow += us;
+  }
+
+  /** Advance the time by `us' microseconds, e.g. to pass time between samples */
+  void advance(unsigned long us) {
+    mNow += us;
+  }
+
+private:
+  /** Time in microseconds, wide enough for millis() not to wrap with micros() */
+  uint64_t mNow;
+};
+
+#endif /* SHTVIRTUALCLOCK_H */
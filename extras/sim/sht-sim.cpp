@@ -0,0 +1,80 @@
+/*
+ * Run the library against simulated sensors, without any hardware
+ *
+ * A virtual clock lets the simulated day of samples finish in milliseconds.
+ *
+ * Build from the root of the library:
+ *   g++ -std=gnu++11 -O2 -I. -Iextras/sim extras/sim/sht-sim.cpp \
+ *       extras/sim/SHTSimulatedBus.cpp SHTSensor.cpp -o sht-sim
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "SHTSensor.h"
+#include "SHTSimulatedBus.h"
+#include "SHTVirtualClock.h"
+
+int main()
+{
+  SHTVirtualClock virtualClock;
+  SHTClock::setCurrent(&virtualClock);
+
+  SHTSimulatedBus bus;
+  SHT3xSimulatedDevice sht3x(0x44);
+  SHT4xSimulatedDevice sht4x(0x45);
+  SHTC1SimulatedDevice shtc1;
+  // one cycle per day around 21 degrees Celsius, constant humidity
+  sht3x.setTemperature(SHTSimulatedWaveform(21, 4, 24 * 3600));
+  sht4x.setHumidity(SHTSimulatedWaveform(40));
+  bus.attach(sht3x);
+  bus.attach(sht4x);
+  bus.attach(shtc1);
+
+  SHTSensor::SHTScanResult found = SHTSensor::scanBus(bus);
+  for (uint8_t i = 0; i < found.count; ++i) {
+    printf("found sensor type %d at 0x%02x\n", found.sensors[i].sensorType,
+           found.sensors[i].i2cAddress);
+  }
+
+  SHTSensor sht1(bus, SHTSensor::SHT3X);
+  SHTSensor sht2(bus, SHTSensor::SHT4X, 0x45);
+  SHTSensor sht3(bus, SHTSensor::SHTC1);
+  SHTSensor *sensors[] = { &sht1, &sht2, &sht3 };
+  const uint8_t count = sizeof(sensors) / sizeof(sensors[0]);
+  for (uint8_t i = 0; i < count; ++i) {
+    if (!sensors[i]->init()) {
+      printf("init() of sensor %u failed\n", i);
+      return 1;
+    }
+  }
+
+  // one sample per minute for a day
+  SHTSensorGroup group(sensors, count);
+  unsigned long failures = 0;
+  float minimum = 100;
+  float maximum = -100;
+  clock_t start = clock();
+  for (int minute = 0; minute < 24 * 60; ++minute) {
+    if (!group.readSample()) {
+      ++failures;
+    }
+    if (sht1.getTemperature() < minimum) {
+      minimum = sht1.getTemperature();
+    }
+    if (sht1.getTemperature() > maximum) {
+      maximum = sht1.getTemperature();
+    }
+    virtualClock.advance(60 * 1000000UL);
+  }
+  printf("simulated one day in %.1f ms, %lu failed rounds\n",
+         (clock() - start) * 1000.0 / CLOCKS_PER_SEC, failures);
+  printf("sensor 0: T between %.2f and %.2f\n", minimum, maximum);
+  for (uint8_t i = 0; i < count; ++i) {
+    printf("sensor %u: RH: %.2f  T: %.2f\n", i, sensors[i]->getHumidity(),
+           sensors[i]->getTemperature());
+  }
+  printf("bus: %lu writes, %lu reads, %lu NACKs\n",
+         bus.mWrites, bus.mReads, bus.mNacks);
+  return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * Check the CRC8 implementation selected with SHT_CRC8_IMPL against the
+ * bitwise definition of the CRC for all 2^16 two byte words, the input of
+ * every CRC check of the drivers. Since each implementation is checked
+ * against the same reference, all of them agree.
+ *
+ * Build from the root of the library, once per implementation:
+ *   g++ -std=gnu++11 -DSHT_CRC8_IMPL=SHT_CRC8_BYTE_TABLE -I. -Iextras/sim \
+ *       extras/test/crc8-test.cpp extras/sim/SHTSimulatedBus.cpp \
+ *       SHTSensor.cpp -o crc8-test
+ * or run extras/test/run.sh to build and run all tests.
+ *
+ * Exits with a non-zero status if any CRC differs.
+ */
+
+#include <stdio.h>
+
+#include "SHTSensor.h"
+
+#if SHT_CRC8_IMPL == SHT_CRC8_NIBBLE_TABLE
+static const char CRC8_IMPL[] = "nibble_table";
+#elif SHT_CRC8_IMPL == SHT_CRC8_BYTE_TABLE
+static const char CRC8_IMPL[] = "byte_table";
+#else
+static const char CRC8_IMPL[] = "bitwise";
+#endif
+
+/** Exposes the CRC check of the drivers */
+class CrcAccess : public SHTI2cSensor
+{
+public:
+  using SHTI2cSensor::crc8;
+};
+
+/** CRC8 with polynomial 0x31 and initial value 0xff, bit by bit */
+static uint8_t referenceCrc8(const uint8_t *data, uint8_t len)
+{
+  uint8_t crc = 0xff;
+  for (uint8_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+int main()
+{
+  unsigned long mismatches = 0;
+  for (uint32_t word = 0; word <= 0xffff; ++word) {
+    const uint8_t data[2] = { (uint8_t)(word >> 8), (uint8_t)word };
+    uint8_t expected = referenceCrc8(data, sizeof(data));
+    uint8_t actual = CrcAccess::crc8(data, sizeof(data));
+    if (actual != expected) {
+      if (mismatches < 10) {
+        fprintf(stderr, "%s: crc8(0x%04lx) = 0x%02x, expected 0x%02x\n",
+                CRC8_IMPL, (unsigned long)word, actual, expected);
+      }
+      ++mismatches;
+    }
+  }
+
+  // datasheet example: CRC of 0xBEEF is 0x92
+  const uint8_t beef[2] = { 0xbe, 0xef };
+  if (CrcAccess::crc8(beef, sizeof(beef)) != 0x92) {
+    fprintf(stderr, "%s: crc8(0xbeef) is not 0x92\n", CRC8_IMPL);
+    ++mismatches;
+  }
+
+  printf("crc8 %s: %lu mismatches in 65536 words\n", CRC8_IMPL, mismatches);
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Compare the fixed-point conversion of every driver with the exact
+ * conversion formula and with the floating point conversion of the driver
+ * for all 65536 raw values.
+ *
+ * The fixed-point value is the exact value rounded to the nearest hundredth,
+ * up to 0.00002 hundredths lost by dividing by 65535 with shifts (see
+ * SHTI2cSensor::fixedPointScale()). The floating point conversion itself is
+ * off by up to a few float ulps of values around 100, below 0.005 hundredths.
+ *
+ * Build from the root of the library:
+ *   g++ -std=gnu++11 -I. -Iextras/sim extras/test/fixed-point-test.cpp \
+ *       extras/sim/SHTSimulatedBus.cpp SHTSensor.cpp -o fixed-point-test
+ * or run extras/test/run.sh to build and run all tests.
+ *
+ * Exits with a non-zero status if an error exceeds its bound.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "SHTSensor.h"
+#include "SHTSimulatedBus.h"
+
+/** Bound of the error against the exact formula, in hundredths */
+static const double MAX_EXACT_ERROR = 0.5 + 0.00002;
+/** Bound of the error against the floating point conversion, in hundredths */
+static const double MAX_FLOAT_ERROR = MAX_EXACT_ERROR + 0.005;
+
+/** Checks one driver; `a' to `z' are the coefficients of its datasheet */
+static bool check(const char *name, const SHTSensorDriver &driver,
+                  double a, double b, double c, double x, double y, double z)
+{
+  double exactError = 0;
+  double floatError = 0;
+  for (uint32_t raw = 0; raw <= 0xffff; ++raw) {
+    double temperature = driver.convertTemperatureCentiCelsius((uint16_t)raw);
+    double humidity = driver.convertHumidityCentiPercent((uint16_t)raw);
+
+    exactError = fmax(exactError,
+                      fabs(temperature - 100 * (a + b * (raw / c))));
+    exactError = fmax(exactError,
+                      fabs(humidity - 100 * (x + y * (raw / z))));
+    floatError = fmax(floatError, fabs(temperature -
+        100.0 * driver.convertTemperature((uint16_t)raw)));
+    floatError = fmax(floatError, fabs(humidity -
+        100.0 * driver.convertHumidity((uint16_t)raw)));
+  }
+
+  bool success = exactError <= MAX_EXACT_ERROR &&
+      floatError <= MAX_FLOAT_ERROR;
+  printf("%s: max error %.5f hundredths against the formula, %.5f against "
+         "the float conversion%s\n", name, exactError, floatError,
+         success ? "" : " - above the bound");
+  return success;
+}
+
+int main()
+{
+  // the conversion does not use the bus
+  SHTSimulatedBus bus;
+  SHT3xSensor sht3x(bus);
+  SHT4xSensor sht4x(bus);
+  SHTC1Sensor shtc1(bus);
+
+  bool success = true;
+  success &= check("SHT3x", sht3x, -45, 175, 65535, 0, 100, 65535);
+  success &= check("SHT4x", sht4x, -45, 175, 65535, -6, 125, 65535);
+  success &= check("SHTC1", shtc1, -45, 175, 65535, 0, 100, 65535);
+  return success ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/*
+ * Check the batched reads of SHTLinuxI2cBus when one sensor of a group does
+ * not respond, with and without I2C_FUNC_PROTOCOL_MANGLING support of the
+ * adapter.
+ *
+ * The I2C_RDWR transaction is emulated on simulated devices the way the
+ * kernel runs it: the messages are transferred in order, and a NACK aborts
+ * the rest of the transaction unless the message has I2C_M_IGNORE_NAK set,
+ * in which case the read returns the idle bus level.
+ *
+ * Build from the root of the library:
+ *   g++ -std=gnu++11 -I. -Iextras/sim extras/test/linux-batch-test.cpp \
+ *       extras/sim/SHTSimulatedBus.cpp SHTSensor.cpp SHTLinuxI2cBus.cpp \
+ *       -o linux-batch-test
+ * or run extras/test/run.sh to build and run all tests.
+ *
+ * Exits with a non-zero status if a check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <linux/i2c.h>
+
+#include "SHTSensor.h"
+#include "SHTLinuxI2cBus.h"
+#include "SHTSimulatedBus.h"
+#include "SHTVirtualClock.h"
+
+/** SHTLinuxI2cBus running its transactions on a SHTSimulatedBus */
+class EmulatedLinuxBus : public SHTLinuxI2cBus
+{
+public:
+  EmulatedLinuxBus(SHTSimulatedBus &bus, bool protocolMangling)
+      : SHTLinuxI2cBus("/dev/null"), mTransfers(0), mBus(bus)
+  {
+    mFunctionality = protocolMangling ? I2C_FUNC_PROTOCOL_MANGLING : 0;
+  }
+
+  unsigned long mTransfers;
+
+protected:
+  virtual bool transfer(struct i2c_msg *messages, uint32_t count)
+  {
+    ++mTransfers;
+    for (uint32_t i = 0; i < count; ++i) {
+      bool acknowledged;
+      if (messages[i].flags & I2C_M_RD) {
+        acknowledged = mBus.read((uint8_t)messages[i].addr, messages[i].buf,
+                                 (uint8_t)messages[i].len);
+        if (!acknowledged) {
+          memset(messages[i].buf, 0xff, messages[i].len);
+        }
+      } else {
+        acknowledged = mBus.write((uint8_t)messages[i].addr, messages[i].buf,
+                                  (uint8_t)messages[i].len);
+      }
+      if (!acknowledged && !(messages[i].flags & I2C_M_IGNORE_NAK)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  SHTSimulatedBus &mBus;
+};
+
+static bool check(const char *name, bool success)
+{
+  printf("%s: %s\n", name, success ? "ok" : "FAILED");
+  return success;
+}
+
+/**
+ * Read a group of three SHT4x whose second one is not done converting, and
+ * compare the valid samples with `expected', one bit per sensor
+ */
+static bool readGroup(const char *name, bool protocolMangling,
+                      uint8_t expected)
+{
+  SHTSimulatedBus simulatedBus;
+  SHT4xSimulatedDevice devices[3] = {
+    SHT4xSimulatedDevice(0x44),
+    SHT4xSimulatedDevice(0x45),
+    SHT4xSimulatedDevice(0x46)
+  };
+  for (uint8_t i = 0; i < 3; ++i) {
+    simulatedBus.attach(devices[i]);
+  }
+
+  EmulatedLinuxBus bus(simulatedBus, protocolMangling);
+  SHTSensor sht0(bus, SHTSensor::SHT4X, 0x44);
+  SHTSensor sht1(bus, SHTSensor::SHT4X, 0x45);
+  SHTSensor sht2(bus, SHTSensor::SHT4X, 0x46);
+  SHTSensor *sensors[] = { &sht0, &sht1, &sht2 };
+  SHTSensorGroup group(sensors, 3);
+
+  bool success = sht0.init() && sht1.init() && sht2.init();
+  // the second sensor is still converting when the group reads the results
+  devices[1].setConversionTimePercent(200);
+  bus.mTransfers = 0;
+  success &= !group.readSample();
+
+  uint8_t valid = 0;
+  for (uint8_t i = 0; i < 3; ++i) {
+    if (group.isSampleValid(i)) {
+      valid |= 1 << i;
+    }
+  }
+  printf("%s: valid samples 0x%x, %lu transfers\n", name, valid,
+         bus.mTransfers);
+  return check(name, success && valid == expected);
+}
+
+int main()
+{
+  SHTVirtualClock virtualClock;
+  SHTClock::setCurrent(&virtualClock);
+
+  bool success = true;
+  // the results of both other sensors are read in the one transaction
+  success &= readGroup("batch ignoring the NACK", true, 0x5);
+  // the abort loses the result of the first sensor, the retry reads the third
+  success &= readGroup("batch aborted by the NACK", false, 0x4);
+
+  SHTClock::setCurrent(NULL);
+  return success ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/*
+ * Check that an SHT3x left in the periodic mode, e.g. by a reset of the host
+ * while it was measuring periodically, is detected and read in single shot
+ * mode by a new SHTSensor without power cycling the sensor.
+ *
+ * Build from the root of the library:
+ *   g++ -std=gnu++11 -I. -Iextras/sim extras/test/periodic-reset-test.cpp \
+ *       extras/sim/SHTSimulatedBus.cpp SHTSensor.cpp -o periodic-reset-test
+ * or run extras/test/run.sh to build and run all tests.
+ *
+ * Exits with a non-zero status if a check fails.
+ */
+
+#include <stdio.h>
+
+#include "SHTSensor.h"
+#include "SHTSimulatedBus.h"
+#include "SHTVirtualClock.h"
+
+static bool check(const char *name, bool success)
+{
+  printf("%s: %s\n", name, success ? "ok" : "FAILED");
+  return success;
+}
+
+/** Leaves the SHT3x on `bus' measuring periodically, as before a host reset */
+static bool startPeriodicMode(SHTSimulatedBus &bus)
+{
+  SHTSensor sht(bus, SHTSensor::SHT3X);
+  return sht.init() &&
+      sht.startPeriodicMeasurement(SHTSensor::SHT_PERIODIC_10_MPS);
+}
+
+int main()
+{
+  SHTVirtualClock virtualClock;
+  SHTClock::setCurrent(&virtualClock);
+
+  SHTSimulatedBus bus;
+  SHT3xSimulatedDevice device(0x44);
+  bus.attach(device);
+
+  bool success = true;
+
+  success &= check("periodic mode started", startPeriodicMode(bus));
+  {
+    SHTSensor sht(bus, SHTSensor::SHT3X);
+    success &= check("init of the known type", sht.init());
+    success &= check("single shot read", sht.readSample());
+  }
+
+  success &= check("periodic mode started", startPeriodicMode(bus));
+  {
+    SHTSensor sht(bus);
+    success &= check("auto detection", sht.init() &&
+                     sht.mSensorType == SHTSensor::SHT3X);
+  }
+
+  success &= check("periodic mode started", startPeriodicMode(bus));
+  {
+    SHTSensor::SHTScanResult found = SHTSensor::scanBus(bus);
+    success &= check("bus scan", found.count == 1 &&
+                     found.sensors[0].sensorType == SHTSensor::SHT3X);
+  }
+
+  success &= check("periodic mode started", startPeriodicMode(bus));
+  {
+    SHT3xSensor driver(bus);
+    bool started = driver.startMeasurement();
+    virtualClock.delay(15);
+    success &= check("non-blocking read", started && driver.fetchSample());
+  }
+
+  SHTClock::setCurrent(NULL);
+  return success ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# Build and run the host tests in extras/test: the CRC8 check once per CRC
+# implementation, the fixed-point conversion check and the simulated sensor
+# tests, on Linux also the batched reads of SHTLinuxI2cBus. The library
+# objects are checked for heap allocation with extras/check-no-heap.sh first.
+#
+# Usage: extras/test/run.sh
+#
+# Set CXX to use another compiler and CXXFLAGS to add compiler flags. Exits
+# with a non-zero status if a test fails.
+
+set -e
+
+root=$(cd "$(dirname "$0")/../.." && pwd)
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+
+# build extras/test/$1.cpp with the simulated bus and the flags $2..., and run it
+run_test() {
+  name=$1
+  shift
+  ${CXX:-g++} -std=gnu++11 -O2 $CXXFLAGS "$@" \
+      -I"$root" -I"$root/extras/sim" \
+      "$root/extras/test/$name.cpp" \
+      "$root/extras/sim/SHTSimulatedBus.cpp" "$root/SHTSensor.cpp" \
+      -o "$build/$name"
+  "$build/$name"
+}
+
+# the library itself, without the host-only simulation
+for source in SHTSensor.cpp SHTSampleStatistics.cpp SHTLinuxI2cBus.cpp; do
+  ${CXX:-g++} -std=gnu++11 -O2 $CXXFLAGS -I"$root" -c "$root/$source" \
+      -o "$build/$source.o"
+done
+"$root/extras/check-no-heap.sh" "$build"/*.o
+echo "no heap allocation referenced"
+
+for impl in SHT_CRC8_BITWISE SHT_CRC8_NIBBLE_TABLE SHT_CRC8_BYTE_TABLE; do
+  run_test crc8-test -DSHT_CRC8_IMPL=$impl
+done
+
+run_test fixed-point-test
+run_test periodic-reset-test
+
+if [ "$(uname -s)" = Linux ]; then
+  run_test linux-batch-test "$root/SHTLinuxI2cBus.cpp"
+fi